@@ -0,0 +1,79 @@
+//
+// Created by irwin on 16/10/2026.
+//
+
+#ifndef CPP_ARENA_H
+#define CPP_ARENA_H
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace corny {
+    /**
+     * Arena: bump allocator used for the AST. Objects are carved out of large chunks
+     * and released all together when the arena is destroyed. Only objects that own
+     * memory outside the arena (std::string, std::vector...) are remembered, so their
+     * destructors can run before the chunks are freed.
+     */
+    class Arena {
+    public:
+        static const size_t CHUNK_SIZE = 16 * 1024;
+
+        Arena() {}
+        ~Arena() {
+            clear();
+        }
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        // make: construct a T inside the arena.
+        template <class T, class... Args>
+        T* make(Args&&... args) {
+            void* memory = allocate(sizeof(T), alignof(T));
+            T* obj = new (memory) T(std::forward<Args>(args)...);
+            if (!std::is_trivially_destructible<T>::value) {
+                finalizers.emplace_back(obj, [](void* ptr) { ((T*)ptr)->~T(); });
+            }
+            return obj;
+        }
+        // allocate: bump the cursor, a new chunk is started when the current one is full.
+        void* allocate(size_t size, size_t align) {
+            size_t offset = (align - ((uintptr_t)cursor % align)) % align;
+            if (cursor == nullptr || cursor + offset + size > limit) {
+                size_t chunkSize = (size + align > CHUNK_SIZE) ? size + align : CHUNK_SIZE;
+                char* chunk = (char*)std::malloc(chunkSize);
+                if (chunk == nullptr) throw std::bad_alloc();
+                chunks.emplace_back(chunk);
+                cursor = chunk;
+                limit = chunk + chunkSize;
+                offset = (align - ((uintptr_t)cursor % align)) % align;
+            }
+            void* memory = cursor + offset;
+            cursor += offset + size;
+            return memory;
+        }
+        // clear: destroy every object and give the chunks back.
+        void clear() {
+            for (auto it = finalizers.rbegin(); it != finalizers.rend(); ++it) {
+                it->second(it->first);
+            }
+            finalizers.clear();
+            for (auto chunk : chunks) {
+                std::free(chunk);
+            }
+            chunks.clear();
+            cursor = nullptr;
+            limit = nullptr;
+        }
+
+        std::vector<char*> chunks;
+        char* cursor = nullptr;
+        char* limit = nullptr;
+        std::vector<std::pair<void*, void (*)(void*)>> finalizers;
+    };
+}
+
+#endif //CPP_ARENA_H
@@ -6,7 +6,12 @@
 #define CPP_AST_H
 #include <iostream>
 #include <vector>
+#include <unordered_map>
 #include "token.h"
+#include "arena.h"
+#include "source.h"
+#include "symbol.h"
+#include "cache.h"
 
 namespace corny {
     // NodeType
@@ -27,27 +32,52 @@ namespace corny {
         NT_BOOLEAN,
         NT_NULL,
         NT_IF,
+        NT_WHILE,
+        NT_FOR,
     };
+    class Evaluator;
+    class Value;
+    class BinOpNode;
+    // BinaryOp: the operator variant a BinOpNode rewrote itself into the first time it ran,
+    // nullptr before that (see Evaluator::quickenBinary).
+    typedef Value (*BinaryOp)(Evaluator& evaluator, BinOpNode* binOpNode, Value leftObj, Value rightObj);
     // Node base class: all nodes will inherit from it.
+    // Nodes live in the Arena of their ProgramNode, they never delete each other.
     class Node {
     public:
         Node() {};
-        ~Node() {};
+        virtual ~Node() {};
         NodeType type;
         virtual std::string toString() = 0;
     };
-    // ProgramNode
+    // ProgramNode: owns the arena of every node in the program.
     class ProgramNode : public Node {
     public:
         ProgramNode() {
             this->type = NT_PROGRAM;
         }
         ~ProgramNode() {
-            for (auto statement : statements) {
-                delete statement;
-            }
+            delete source;
         }
+        Source* source = nullptr; // identifiers and strings of the AST point into it
+        Arena arena;
         std::vector<Node*> statements;
+        int liveFunctions = 0; // FunctionObjs whose body lives in this program
+        bool released = false;
+
+        // release: the owner is done with the program, the whole AST is freed as soon
+        // as no FunctionObj points into it anymore.
+        void release() {
+            released = true;
+            if (liveFunctions == 0) delete this;
+        }
+        void retain() {
+            liveFunctions += 1;
+        }
+        void unretain() {
+            liveFunctions -= 1;
+            if (released && liveFunctions == 0) delete this;
+        }
 
         std::string toString() {
             std::string result;
@@ -65,11 +95,6 @@ namespace corny {
         BlockNode() {
             this->type = NT_BLOCK;
         }
-        ~BlockNode() {
-            for (auto stmt : statements) {
-                delete stmt;
-            }
-        }
         std::vector<Node*> statements;
         std::string toString() {
             std::string result = "\n{\n";
@@ -92,9 +117,6 @@ namespace corny {
             this->value = value;
             this->type = NT_RETURN;
         }
-        ~ReturnNode() {
-            delete value;
-        }
         Node* value;
         std::string toString() {
             return "return " + value->toString();
@@ -106,10 +128,6 @@ namespace corny {
         BinOpNode() {
             this->type = NT_BINARY;
         }
-        ~BinOpNode() {
-            delete left;
-            delete right;
-        }
         BinOpNode(Node* left, Token opToken, Node* right) {
             this->left = left;
             this->opToken = opToken;
@@ -119,8 +137,9 @@ namespace corny {
         Node* left;
         Token opToken;
         Node* right;
+        BinaryOp op = nullptr;
         std::string toString() {
-            return left->toString() + " " + opToken.literal + " " + right->toString();
+            return left->toString() + " " + std::string(opToken.literal) + " " + right->toString();
         }
     };
     // UnaryNode
@@ -134,13 +153,10 @@ namespace corny {
             this->opToken = opToken;
             this->type = NT_UNARY;
         }
-        ~UnaryNode() {
-            delete left;
-        }
         Node* left;
         Token opToken;
         std::string toString() {
-            return left->toString() + " " + opToken.literal;
+            return left->toString() + " " + std::string(opToken.literal);
         }
     };
     // CallExprNode
@@ -149,14 +165,10 @@ namespace corny {
         CallExprNode() {
             this->type = NT_CALL;
         }
-        ~CallExprNode() {
-            delete callee;
-            for (auto argument : arguments) {
-                delete argument;
-            }
-        }
         Node* callee;
         std::vector<Node*> arguments;
+        bool tail = false; // its value is the value of the enclosing function, set by the Resolver
+        InlineCache cache;
 
         std::string toString() {
             std::string result = callee->toString();
@@ -187,14 +199,9 @@ namespace corny {
         IfNode() {
             this->type = NT_IF;
         }
-        ~IfNode() {
-            delete condition;
-            delete consequence;
-            delete alternative;
-        }
-        Node* condition;
-        Node* consequence;
-        Node* alternative;
+        Node* condition = nullptr;
+        Node* consequence = nullptr;
+        Node* alternative = nullptr;
         std::string toString() {
             std::string result = "if(";
             result += condition->toString() + ")";
@@ -231,13 +238,15 @@ namespace corny {
         StringNode() {
             this->type = NT_STRING;
         };
-        StringNode(std::string value) {
+        StringNode(std::string_view value, Symbol* symbol) {
             this->value = value;
+            this->symbol = symbol;
             this->type = NT_STRING;
         }
-        std::string value;
+        std::string_view value; // view into the source text
+        Symbol* symbol = nullptr; // the interned value
         std::string toString() {
-            return '\"' + value + '\"';
+            return '\"' + std::string(value) + '\"';
         }
     };
     // BooleanNode
@@ -266,9 +275,13 @@ namespace corny {
             this->type = NT_IDENT;
         }
         Token value;
+        // lexical address filled by the Resolver: how many environments to walk out
+        // and the slot inside that environment. depth -1 means "look it up by name".
+        int depth = -1;
+        int slot = -1;
 
         std::string toString() {
-            return value.literal;
+            return std::string(value.literal);
         }
     };
     // NullNode
@@ -287,30 +300,70 @@ namespace corny {
         LetNode() {
             this->type = NT_LET;
         }
-        ~LetNode() {
-            delete ident;
-            delete value;
-        }
         IdentNode* ident;
         Node* value;
         std::string toString() {
             return "let " + ident->toString() + " = " + value->toString();
         }
     };
+    // WhileNode: the body runs in the enclosing environment, a loop never creates one.
+    class WhileNode : public Node {
+    public:
+        WhileNode() {
+            this->type = NT_WHILE;
+        }
+        Node* condition = nullptr;
+        BlockNode* body = nullptr;
+        std::string toString() {
+            return "while(" + condition->toString() + ")" + body->toString();
+        }
+    };
+    // ForNode: 'for (ident in iterable)', the variable is a local of the enclosing scope.
+    class ForNode : public Node {
+    public:
+        ForNode() {
+            this->type = NT_FOR;
+        }
+        IdentNode* ident = nullptr;
+        Node* iterable = nullptr;
+        BlockNode* body = nullptr;
+        std::string toString() {
+            return "for(" + ident->toString() + " in " + iterable->toString() + ")" + body->toString();
+        }
+    };
+    // Scope: maps the names declared in a function body (or in the global
+    // environment) to the slots of its Environment. Names are interned symbols.
+    class Scope {
+    public:
+        Scope() {}
+        std::unordered_map<const Symbol*, int> slots;
+        // declare a name, declaring it twice returns the same slot.
+        int declare(const Symbol* name) {
+            auto it = slots.find(name);
+            if (it != slots.end()) return it->second;
+            int slot = slots.size();
+            slots.emplace(name, slot);
+            return slot;
+        }
+        // find the slot of a name, -1 when it is not declared in this scope.
+        int find(const Symbol* name) {
+            auto it = slots.find(name);
+            return (it != slots.end()) ? it->second : -1;
+        }
+        int size() {
+            return slots.size();
+        }
+    };
     // FunctionNode
     class FunctionNode : public Node {
     public:
         FunctionNode() {
             this->type = NT_FUNCTION;
         }
-        ~FunctionNode() {
-            for (auto param : parameters) {
-                delete param;
-            }
-            delete body;
-        }
         std::vector<IdentNode*> parameters;
         BlockNode* body;
+        Scope scope; // parameters and locals, filled by the Resolver
+        ProgramNode* program = nullptr; // the program that owns this node
 
         std::string toString() {
             std::string result = "fn(";
@@ -333,11 +386,6 @@ namespace corny {
         ArrayNode() {
             this->type = NT_ARRAY;
         }
-        ~ArrayNode() {
-            for (auto element : elements) {
-                delete element;
-            }
-        }
         std::vector<Node*> elements;
 
         std::string toString() {
@@ -360,14 +408,6 @@ namespace corny {
         HashNode() {
             this->type = NT_HASH;
         }
-        ~HashNode() {
-            for (auto key : keys) {
-                delete key;
-            }
-            for (auto value : values) {
-                delete value;
-            }
-        }
         std::vector<IdentNode*> keys;
         std::vector<Node*> values;
 
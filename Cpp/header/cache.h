@@ -0,0 +1,56 @@
+//
+// Created by irwin on 16/10/2026.
+//
+
+#ifndef CPP_CACHE_H
+#define CPP_CACHE_H
+#include <cstdint>
+#include <string_view>
+#include "table.h"
+
+namespace corny {
+    struct Symbol;
+
+    /**
+     * InlineCache: where the hash subscripts of a call site found their key, so the next
+     * lookup skips the hash probe. A site remembers up to SIZE positions, once it is full it
+     * is megamorphic and takes the slow path for any other layout.
+     *
+     * Positions are remembered for one interned key, the first one the site looked up (a
+     * constant key like row["field"] is always the same). A cached position is checked by
+     * comparing the key of the entry at that position: entries never move once added, so the
+     * check is exact whatever else the table holds, and hashes built the same way share it.
+     * Symbols live as long as the process, so a cached key is never recycled.
+     */
+    class InlineCache {
+    public:
+        static constexpr int SIZE = 4;
+
+        // find: HashTable::find, trying the cached positions first.
+        Value* find(HashTable& table, std::string_view key, uint32_t hash, const Symbol* symbol) {
+            if (symbol != nullptr && symbol == this->symbol) {
+                for (int i = 0; i < positionCount; i++) {
+                    int32_t position = positions[i];
+                    if ((size_t)position < table.entries.size() && table.entries[position].symbol == symbol) {
+                        return &table.entries[position].value;
+                    }
+                }
+            }
+            int32_t position = table.position(key, hash, symbol);
+            if (position < 0) return nullptr;
+            // only an interned key of an interned entry can be checked by identity.
+            if (symbol != nullptr && table.entries[position].symbol == symbol && positionCount < SIZE) {
+                if (this->symbol == nullptr) this->symbol = symbol;
+                if (this->symbol == symbol) positions[positionCount++] = position;
+            }
+            return &table.entries[position].value;
+        }
+
+    private:
+        const Symbol* symbol = nullptr; // the key of the cached positions
+        int32_t positions[SIZE];
+        uint8_t positionCount = 0;
+    };
+}
+
+#endif //CPP_CACHE_H
@@ -0,0 +1,141 @@
+//
+// Created by irwin on 16/10/2026.
+//
+
+#ifndef CPP_CODE_H
+#define CPP_CODE_H
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "object.h"
+
+namespace corny {
+    // OpCode: every instruction is one byte followed by its operands.
+    // u16 operands are stored big endian.
+    enum OpCode : uint8_t {
+        OP_CONSTANT,        // [u16 index] push constants[index]
+        OP_TRUE,
+        OP_FALSE,
+        OP_NULL,
+        OP_POP,
+        OP_GET_NAME,        // [u16 name] push the value bound to names[name], looked up by name
+        OP_GET_SLOT,        // [u8 depth][u16 slot][u16 name] push a variable by its lexical address
+        OP_SET_SLOT,        // [u16 slot] bind a slot of the current environment to the top of the stack (the value stays)
+
+        // Arithmetic and relational operators
+        OP_ADD,
+        OP_SUB,
+        OP_MUL,
+        OP_DIV,
+        OP_LESS,
+        OP_LESS_EQ,
+        OP_GREATER,
+        OP_GREATER_EQ,
+        OP_EQUAL,
+        OP_NOT_EQ,
+        OP_NEGATE,
+        OP_NOT,
+
+        // Logical operators
+        OP_AND,             // [u16 offset] jump keeping the left operand if it is false
+        OP_OR,              // [u16 offset] jump keeping the left operand if it is true
+        OP_CHECK_BOOL,      // the right operand of 'and'/'or' must be a boolean
+
+        // Control flow
+        OP_JUMP,            // [u16 offset] forward jump
+        OP_JUMP_IF_FALSE,   // [u16 offset] pop the condition and jump if it is false
+        OP_WHILE,           // [u16 offset] pop the loop condition and jump out of the loop if it is false
+        OP_FOR,             // [u16 slot][u16 offset] bind the next element of the array below the index, or pop both and jump out
+        OP_LOOP,            // [u16 offset] backward jump
+
+        // Compound literals
+        OP_ARRAY,           // [u16 count] build an array from the top 'count' values
+        OP_HASH_KEY,        // the key on top of the stack must be a string
+        OP_HASH,            // [u16 count] build a hash from the top 'count' key-value pairs
+
+        // Functions
+        OP_CLOSURE,         // [u16 index] create a FunctionObj for functions[index]
+        OP_CALL,            // [u8 argc][u16 cache] call, index or lookup the callee below the arguments
+        OP_TAIL_CALL,       // [u8 argc][u16 cache] like OP_CALL, a function replaces the frame of the current one
+        OP_RETURN,
+    };
+
+    class FunctionProto;
+
+    /**
+     * Chunk: a compiled sequence of instructions together with its constant pool.
+     */
+    class Chunk {
+    public:
+        Chunk() {}
+        std::vector<uint8_t> code;
+        std::vector<Value> constants; // literals: numbers and immortal strings (see literalString), never collected.
+        std::vector<const Symbol*> names; // identifiers referenced by OP_GET_NAME/OP_GET_SLOT
+        std::vector<FunctionProto*> functions;
+        std::vector<InlineCache> caches; // one per OP_CALL/OP_TAIL_CALL
+
+        void write(uint8_t byte) {
+            code.emplace_back(byte);
+        }
+        void writeShort(uint16_t value) {
+            code.emplace_back((value >> 8) & 0xff);
+            code.emplace_back(value & 0xff);
+        }
+        uint16_t readShort(size_t offset) const {
+            return (uint16_t)((code[offset] << 8) | code[offset + 1]);
+        }
+        // addConstant, addName: the index of the entry, the Compiler checks that it fits an operand.
+        int addConstant(Value constant) {
+            constants.emplace_back(constant);
+            return constants.size() - 1;
+        }
+        int addCache() {
+            caches.emplace_back();
+            return caches.size() - 1;
+        }
+        // names are deduplicated, every identifier is stored once per chunk.
+        int addName(const Symbol* name) {
+            for (size_t i = 0; i < names.size(); i++) {
+                if (names[i] == name) return i;
+            }
+            names.emplace_back(name);
+            return names.size() - 1;
+        }
+    };
+
+    /**
+     * FunctionProto: the compiled form of a FunctionNode (or of a whole program).
+     * The proto of a whole program (its script) owns the protos of its functions.
+     */
+    class FunctionProto {
+    public:
+        FunctionProto() {}
+        ~FunctionProto() {
+            for (auto function : chunk.functions) {
+                delete function;
+            }
+        }
+        std::vector<int> parameters; // slot of every parameter
+        Scope scope;
+        Chunk chunk;
+        FunctionProto* script = this; // the proto of the program this function was compiled from
+        int liveFunctions = 0; // FunctionObjs whose proto belongs to this script
+        bool released = false;
+
+        // release: the owner is done with the script, every proto of it is freed as soon
+        // as no FunctionObj points into it anymore.
+        void release() {
+            released = true;
+            if (liveFunctions == 0) delete this;
+        }
+        void retain() {
+            script->liveFunctions += 1;
+        }
+        void unretain() {
+            script->liveFunctions -= 1;
+            if (script->released && script->liveFunctions == 0) delete script;
+        }
+    };
+}
+
+#endif //CPP_CODE_H
@@ -0,0 +1,42 @@
+//
+// Created by irwin on 16/10/2026.
+//
+
+#ifndef CPP_COMPILER_H
+#define CPP_COMPILER_H
+#include "ast.h"
+#include "code.h"
+
+namespace corny {
+    /**
+     * Compiler: translates the AST produced by the Parser into bytecode for the VM.
+     * The AST must have been annotated by the Resolver.
+     */
+    class Compiler {
+    public:
+        Compiler() {}
+        ~Compiler() {}
+
+        FunctionProto* script = nullptr; // the proto of the program being compiled
+
+        FunctionProto* compile(ProgramNode* programNode);
+        void compileNode(Node* node, Chunk& chunk);
+        void compileStatements(std::vector<Node*>& statements, Chunk& chunk);
+        void compileBinary(BinOpNode* binOpNode, Chunk& chunk);
+        void compileLogical(BinOpNode* binOpNode, Chunk& chunk);
+        void compileIf(IfNode* ifNode, Chunk& chunk);
+        void compileWhile(WhileNode* whileNode, Chunk& chunk);
+        void compileFor(ForNode* forNode, Chunk& chunk);
+        void compileCall(CallExprNode* callExprNode, Chunk& chunk);
+        void compileFunction(FunctionNode* functionNode, Chunk& chunk);
+        void compileArray(ArrayNode* arrayNode, Chunk& chunk);
+        void compileHash(HashNode* hashNode, Chunk& chunk);
+        int emitJump(OpCode opCode, Chunk& chunk);
+        void patchJump(int offset, Chunk& chunk);
+        static void writeOperand(size_t value, const std::string& what, Chunk& chunk);
+        void emitLoop(int loopStart, Chunk& chunk);
+        static void error(std::string message);
+    };
+}
+
+#endif //CPP_COMPILER_H
@@ -4,36 +4,62 @@
 
 #ifndef CPP_ENVIRONMENT_H
 #define CPP_ENVIRONMENT_H
-#include <map>
+#include <vector>
+#include "ast.h"
+#include "value.h"
 #include "object.h"
 
 namespace corny {
-    class Object;
-    class Environment {
+    // Environment: the variables of a call (or of the program). Environments are GC objects
+    // that live in the old generation, they never move. See GarbageCollector::newEnvironment.
+    class Environment : public Object {
     public:
-        Environment() {};
-        Environment(Environment* outer) {
-            this->outer = outer;
+        Environment(Scope* scope, Environment* outer) {
+            this->type = OBJ_ENVIRONMENT;
+            reset(scope, outer);
         }
-        ~Environment() {
-            delete outer;
+        // reset: start over as a fresh environment, used by the frame pool.
+        void reset(Scope* scope, Environment* outer) {
+            this->scope = scope;
+            this->outer = outer;
+            this->slots.assign(scope->size(), Value::empty());
+            this->captured = false;
         }
         Environment* outer = nullptr;
-        std::map<std::string, Object*> symbolTable;
-        // register an object in symbol table.
-        void set(std::string key, Object* value) {
-            symbolTable[key] = value;
+        Scope* scope = nullptr; // names of the slots, only used by the lookup by name.
+        std::vector<Value> slots; // unbound slots hold Value::empty()
+        bool remembered = false; // holds young objects, see GarbageCollector::write
+        bool captured = false; // a closure keeps it alive after its call returns
+
+        std::string Inspect() {
+            return "environment";
+        }
+        // register a value in a slot of this environment.
+        void set(int slot, Value value) {
+            if ((size_t)slot >= slots.size()) slots.resize(slot + 1, Value::empty());
+            __atomic_store_n(&slots[slot].bits, value.bits, __ATOMIC_RELAXED); // a concurrent marker may be reading it
+        }
+        // get a value by its lexical address (see Resolver).
+        Value get(int depth, int slot, const Symbol* key) {
+            Environment* env = this;
+            for (int i = 0; i < depth; i++) {
+                env = env->outer;
+            }
+            if ((size_t)slot < env->slots.size() && !env->slots[slot].isEmpty()) {
+                return env->slots[slot];
+            }
+            // declared but not bound yet: an outer binding may still be visible.
+            return get(key);
         }
-        // get an object from symbol table.
-        Object* get(std::string key) {
-            if (symbolTable.find(key) == symbolTable.end()) {
-                if (outer != nullptr) {
-                    return outer->get(key);
-                } else {
-                    return nullptr;
+        // get a value by name walking the outer environments, Value::empty() if not found.
+        Value get(const Symbol* key) {
+            for (Environment* env = this; env != nullptr; env = env->outer) {
+                int slot = env->scope->find(key);
+                if (slot >= 0 && (size_t)slot < env->slots.size() && !env->slots[slot].isEmpty()) {
+                    return env->slots[slot];
                 }
             }
-            return symbolTable[key];
+            return Value::empty();
         }
     };
 }
@@ -11,42 +11,105 @@
 #include "gc.h"
 
 namespace corny {
+    // Task: a node being evaluated by the stackless mode (see Evaluator::execute) and how
+    // far it got.
+    struct Task {
+        static constexpr int CALL_RUNNING = -1; // a call whose body is being evaluated
+        static constexpr int CALL_READY = -2;   // a call that took over a frame for a tail call
+
+        Node* node;
+        Environment* env;
+        size_t base; // height of the value stack when the task started, its value goes there
+        int state = 0; // which part of the node comes next
+        size_t index = 0; // next element of a for loop
+    };
+
     class Evaluator {
     public:
-        Evaluator() {}
+        Evaluator() {
+            arguments.reserve(256);
+            gc.stacks.emplace_back(&arguments); // the arguments of the calls in progress are roots
+        }
         ~Evaluator() {}
 
-        BooleanObj *TRUE = new BooleanObj(true);
-        BooleanObj *FALSE = new BooleanObj(false);
-        NullObj *NIL = new NullObj();
-
-        static bool isError(Object* obj);
-        Object* eval(Node* node, Environment* env);
-        Object* evalProgram(ProgramNode* programNode, Environment* env);
-        Object* evalBlock(BlockNode* blockNode, Environment* env);
-        Object* evalLet(LetNode* letNode, Environment* env);
-        Object* evalReturn(ReturnNode* returnNode, Environment* env);
-        Object* evalIdentifier(IdentNode* identNode, Environment* env);
-        Object* evalCallExpr(CallExprNode* callExprNode, Environment* env);
-        Object* evalFunctionLiteral(FunctionNode* functionNode, Environment* env);
-        Object* evalFunction(FunctionObj* functionObj, std::vector<Object*> arguments);
-        Object* evalArrayAccess(ArrayObj* arrayObj, std::vector<Object*> arguments);
-        Object* evalHashAccess(HashObj* hashObj, std::vector<Object*> arguments);
-        Object* evalStringAccess(StringObj* stringObj, std::vector<Object*> arguments);
-        Object* evalArrayLiteral(ArrayNode* arrayNode, Environment* env);
-        Object* evalHashLiteral(HashNode* hashNode, Environment* env);
-        Object* evalUnaryExpression(UnaryNode* unaryNode, Environment* env);
-        Object* evalBinaryExpression(BinOpNode* binOpNode, Environment* env);
-        Object* evalLogicalExpression(BinOpNode* binOpNode, Environment* env);
-        Object* evalBinaryString(Object* leftObj, TokenType type, Object* rightObj);
-        Object* evalBinaryInteger(Object* leftObj, TokenType type, Object* rightObj);
-        Object* evalBinaryBoolean(Object* leftObj, TokenType type, Object* rightObj);
-        Object* evalIfExpression(IfNode* ifNode, Environment* env);
-        Object* evalStatements(std::vector<Node*> statements, Environment* env);
+        const Value TRUE = Value::boolean(true);
+        const Value FALSE = Value::boolean(false);
+        const Value NIL = Value::null();
+
+        static constexpr size_t MAX_DEPTH = 10000; // nested calls on the native stack
+        static constexpr size_t STACKLESS_MAX_DEPTH = 1000000; // nested calls in the stackless mode
+        static constexpr size_t STACK_RESERVE = 1024 * 1024; // native stack kept free for the body of the deepest call
+
+        bool stackless = false; // evaluate programs with execute instead of native recursion
+        size_t maxDepth = MAX_DEPTH; // deeper calls stop the program with an error
+        size_t depth = 0; // calls in progress
+        uintptr_t stackLimit = 0; // the recursive mode does not enter calls below this native stack address
+
+        // a 'return', an error or a tail call unwinds as a signal value (see Value::TAG_RETURN)
+        // and leaves its payload here. Nothing is allocated while a signal travels up to the
+        // function call or program that handles it, so returnValue needs no rooting.
+        Value returnValue;
+        std::string errorMessage;
+        size_t tailCall = 0; // where the callee and arguments of a tail call are on the argument stack
+
+        static bool isAbrupt(Value value);
+        Value newError(std::string message);
+        Value eval(Node* node, Environment* env);
+        Value evalProgram(ProgramNode* programNode, Environment* env);
+        Value evalBlock(BlockNode* blockNode, Environment* env);
+        Value evalLet(LetNode* letNode, Environment* env);
+        Value evalReturn(ReturnNode* returnNode, Environment* env);
+        Value evalIdentifier(IdentNode* identNode, Environment* env);
+        Value evalCallExpr(CallExprNode* callExprNode, Environment* env);
+        Value evalFunctionLiteral(FunctionNode* functionNode, Environment* env);
+        Value evalFunction(FunctionObj* functionObj, const Value* args, int argc);
+        Environment* enterFunction(FunctionObj* functionObj, const Value* args, int argc);
+        static size_t nativeStackSize();
+        Value execute(Node* node, Environment* env);
+        size_t runningCall(size_t bottom);
+        Value evalArrayAccess(ArrayObj* arrayObj, const Value* args, int argc);
+        Value evalHashAccess(HashObj* hashObj, const Value* args, int argc, InlineCache& cache);
+        Value evalStringAccess(StringObj* stringObj, const Value* args, int argc);
+        Value evalAccess(CallExprNode* callExprNode, Value calleeObj, const Value* args, int argc);
+        Value evalArrayLiteral(ArrayNode* arrayNode, Environment* env);
+        Value makeArray(size_t base);
+        Value evalHashLiteral(HashNode* hashNode, Environment* env);
+        Value checkKey(Value keyObj);
+        Value makeHash(size_t base);
+        Value evalUnaryExpression(UnaryNode* unaryNode, Environment* env);
+        Value evalUnaryOperator(UnaryNode* unaryNode, Value rightObj);
+        Value evalBinaryExpression(BinOpNode* binOpNode, Environment* env);
+        Value evalBinaryOperator(BinOpNode* binOpNode, Value leftObj, Value rightObj);
+        static Value evalGenericBinary(Evaluator& evaluator, BinOpNode* binOpNode, Value leftObj, Value rightObj);
+        static BinaryOp quickenBinary(BinOpNode* binOpNode, Value leftObj, Value rightObj);
+        static Value despecialize(Evaluator& evaluator, BinOpNode* binOpNode, Value leftObj, Value rightObj);
+        static Value addNumbers(Evaluator& evaluator, BinOpNode* binOpNode, Value leftObj, Value rightObj);
+        static Value subtractNumbers(Evaluator& evaluator, BinOpNode* binOpNode, Value leftObj, Value rightObj);
+        static Value multiplyNumbers(Evaluator& evaluator, BinOpNode* binOpNode, Value leftObj, Value rightObj);
+        static Value lessNumbers(Evaluator& evaluator, BinOpNode* binOpNode, Value leftObj, Value rightObj);
+        static Value greaterNumbers(Evaluator& evaluator, BinOpNode* binOpNode, Value leftObj, Value rightObj);
+        static Value equalNumbers(Evaluator& evaluator, BinOpNode* binOpNode, Value leftObj, Value rightObj);
+        static Value evalNumbers(Evaluator& evaluator, BinOpNode* binOpNode, Value leftObj, Value rightObj);
+        static Value concatStrings(Evaluator& evaluator, BinOpNode* binOpNode, Value leftObj, Value rightObj);
+        Value evalLogicalExpression(BinOpNode* binOpNode, Environment* env);
+        Value checkLogicalOperand(Value operandObj, const char* side);
+        static bool shortCircuits(BinOpNode* binOpNode, Value leftObj);
+        Value evalBinaryString(Value leftObj, TokenType type, Value rightObj);
+        Value evalBinaryInteger(double left, TokenType type, double right);
+        Value evalBinaryBoolean(Value leftObj, TokenType type, Value rightObj);
+        Value evalIfExpression(IfNode* ifNode, Environment* env);
+        Value checkCondition(Value conditionObj, const char* statement);
+        Value evalWhile(WhileNode* whileNode, Environment* env);
+        Value checkIterable(Value iterableObj);
+        Value evalFor(ForNode* forNode, Environment* env);
+        Value evalStatements(std::vector<Node*>& statements, Environment* env);
 
         GarbageCollector gc;
-        int gcCounter = 0;
-        int gcMaxObjects = 100;
+        // argument stack: every call pushes its callee and arguments on top and pops them when
+        // it returns. The callees get (args, argc) pointing into it, valid until they evaluate
+        // anything else. The stackless mode keeps all its intermediate values there.
+        std::vector<Value> arguments;
+        std::vector<Task> tasks; // the stackless mode's continuation stack
     };
 }
 #endif //CPP_EVALUATOR_H
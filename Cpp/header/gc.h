@@ -4,80 +4,294 @@
 
 #ifndef CPP_GC_H
 #define CPP_GC_H
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
 #include "object.h"
 #include "environment.h"
+#include "pool.h"
 
 namespace corny {
     class Environment; // forward reference to avoid the circular dependency
 
+    // GCPhase: where the major collection cycle is, see GarbageCollector::step.
+    enum GCPhase {
+        GC_IDLE,
+        GC_MARKING,
+        GC_SWEEPING,
+    };
+
+    /**
+     * GarbageCollector: a generational collector.
+     *  - new objects are bump allocated in the nursery.
+     *  - a minor collection promotes every young object reachable from the roots or from
+     *    a remembered environment to the old generation and resets the nursery.
+     *  - a major collection marks the old generation from the roots and sweeps its pages.
+     * Environments are the only objects written after they are created, so they are the
+     * only ones that need the write barrier. They are allocated straight in the old
+     * generation, and the ones no closure captured are recycled through a frame pool.
+     * The old generation lives in one Pool per object type: promoting takes a slot from
+     * its free list and sweeping gives it back. Mark bits live in the page headers, in two
+     * bitmaps: each cycle marks in the one the previous cycle did not use, which sweeping
+     * a page clears. Pages are swept lazily, when their pool runs out of free slots.
+     *
+     * With a pause budget the major collection is incremental: a tri-color marking (gray
+     * objects wait in a worklist) and a sweep that run a few microseconds at every minor
+     * collection. Marking is snapshot-at-the-beginning: overwriting a slot shades the
+     * value it held, and objects promoted or allocated while marking are black.
+     *
+     * In concurrent mode the marking runs on a background thread while the interpreter
+     * keeps going. Arrays, hashes and strings are never written once they leave the
+     * nursery, so environments are all the marker has to share: their slots are stored
+     * atomically and resizing them takes envLock. The objects the barrier shades are
+     * handed to the marker through a locked list, and the cycle ends with a short pause
+     * that joins the thread and marks what the barrier shaded last.
+     *
+     * Marking never recurses: gray objects wait in a worklist. With several mark threads
+     * that worklist is split between them and idle threads steal from the busy ones.
+     *
+     * A collection can start at any allocation, so every Value held by an interpreter
+     * must be reachable from the roots: the shadow stack, the registered value stacks
+     * and the environments of the calls in progress (see RootScope).
+     */
     class GarbageCollector {
     public:
-        GarbageCollector() {
-            this->head = new StringObj("head"); // the main object
-        }
-        ~GarbageCollector() {
-            delete head;
-        }
-        // Add an object
-        void add(Object* obj) {
-            obj->next = head->next;
-            head->next = obj;
-        }
-        // Mark an object
-        void mark(Object* obj) {
-            if (obj->mark == true) return;
-            obj->mark = true;
-            // An Array must mark all its elements
-            if (obj->type == OBJ_ARRAY) {
-                for (auto element : ((ArrayObj*)obj)->elements) {
-                    mark(element);
-                }
+        static constexpr size_t NURSERY_SIZE = 256 * 1024;
+        static constexpr size_t HEAP_TARGET = 8 * 1024 * 1024; // old generation bytes before a major collection
+        static constexpr size_t FRAME_POOL_SIZE = 256;
+        static constexpr size_t MARK_CHUNK = 64; // objects marked or swept between two clock reads
+        static constexpr size_t STEAL_BATCH = 64; // a marking thread shares its work above this size
+        static constexpr int TYPE_COUNT = OBJ_ENVIRONMENT + 1;
+
+        GarbageCollector();
+        ~GarbageCollector();
+
+        // make: allocate a new object in the nursery. A collection may run before the
+        // object is constructed, Values passed to the constructor must be rooted.
+        template <class T, class... Args>
+        T* make(Args&&... args) {
+            void* memory = allocate(sizeof(T));
+            T* obj = new (memory) T(std::forward<Args>(args)...);
+            obj->space = SPACE_NURSERY;
+            return obj;
+        }
+        // newEnvironment: environments never move and their allocation never starts a
+        // collection, so the caller does not need to root anything around it.
+        Environment* newEnvironment(Scope* scope, Environment* outer) {
+            if (!framePool.empty()) {
+                Environment* env = framePool.back();
+                framePool.pop_back();
+                auto lock = lockEnvironments();
+                env->reset(scope, outer);
+                if (phase != GC_IDLE) blacken(env); // a new environment, as far as the cycle knows
+                return env;
             }
-            // A Hash table must mark all its elements
-            if (obj->type == OBJ_HASH) {
-                for (std::pair<std::string, Object*> pair : ((HashObj*)obj)->elements) {
-                    Object* element = pair.second;
-                    mark(element);
+            Environment* env = new (allocateOld(OBJ_ENVIRONMENT)) Environment(scope, outer);
+            env->space = SPACE_OLD;
+            if (phase != GC_IDLE) blacken(env);
+            oldBytes += heapSize(env);
+            return env;
+        }
+        // releaseFrame: the call that created 'env' returned, reuse it unless a closure captured it.
+        void releaseFrame(Environment* env) {
+            if (env->captured || framePool.size() >= FRAME_POOL_SIZE) return;
+            if (phase == GC_MARKING) {
+                for (auto value : env->slots) {
+                    shade(value);
                 }
+                if (env->outer != nullptr) mark(env->outer);
             }
+            auto lock = lockEnvironments();
+            env->slots.clear(); // don't keep the old values alive
+            env->outer = nullptr;
+            framePool.emplace_back(env);
         }
-        // overload the mark method to allow Environment
-        void mark(Environment* env) {
-            // Environments must mark all objects contained in its symbol table.
-            for (std::pair<std::string, Object*> p : env->symbolTable) {
-                Object* obj = p.second;
-                mark(obj);
+        // write: store 'value' in a slot of 'env'. The value it replaces is shaded while
+        // marking, and the environments that point into the nursery are remembered.
+        void write(Environment* env, int slot, Value value) {
+            if (phase == GC_MARKING && (size_t)slot < env->slots.size()) shade(env->slots[slot]);
+            if (markerRunning && (size_t)slot >= env->slots.size()) {
+                std::lock_guard<std::mutex> lock(envLock); // the slots are about to move
+                env->set(slot, value);
+            } else {
+                env->set(slot, value);
             }
-            // and dont forget its outer environment
-            if (env->outer != nullptr) {
-                mark(env->outer);
+            if (!env->remembered && value.isObject() && value.asObject()->space == SPACE_NURSERY) {
+                env->remembered = true;
+                remembered.emplace_back(env);
             }
         }
-        // sweep method that find all unreferenced objects and delete them.
-        void sweep() {
-            Object* node = head;
-            // search for unmarked objects
-            while (node->next != nullptr) {
-                if (node->next->mark == false) {
-                    Object* temp = node->next;
-                    node->next = temp->next;
-                    delete temp;
-                } else {
-                    // this object was reached so unmark it (for the next GC)
-                    // and move on to the next.
-                    //node->mark = false;
-                    node = node->next;
-                }
+        void setHeapTarget(size_t bytes) {
+            heapTarget = bytes;
+            nextMajor = bytes;
+        }
+        // setPauseBudget: 0 collects the old generation in one go, anything else makes
+        // the major collection incremental.
+        void setPauseBudget(std::chrono::microseconds budget) {
+            pauseBudget = budget;
+        }
+        // setConcurrent: mark the old generation on a background thread.
+        void setConcurrent(bool concurrent) {
+            this->concurrent = concurrent;
+        }
+        // setMarkThreads: threads that mark in parallel, for a whole major collection or in
+        // the background.
+        void setMarkThreads(int threads) {
+            markThreads = threads;
+        }
+        void collect();
+        void minorCollect();
+        void majorCollect();
+        void mark(Object* obj);
+        void mark(Value value);
+        // shade: the snapshot-at-the-beginning barrier, for a reference that is going away.
+        void shade(Value value) {
+            if (phase == GC_MARKING && value.isObject() && value.asObject()->space == SPACE_OLD) mark(value.asObject());
+        }
+
+        // roots
+        std::vector<Value> roots; // shadow stack for temporaries
+        std::vector<std::vector<Value>*> stacks; // value stacks and argument lists
+        std::vector<Environment*> frames; // environments of the calls in progress
+
+        size_t heapTarget = HEAP_TARGET;
+        size_t oldBytes = 0; // old objects and the memory they own
+        size_t nextMajor = HEAP_TARGET;
+        std::chrono::microseconds pauseBudget{0};
+        bool concurrent = false;
+        int markThreads = 1;
+        GCPhase phase = GC_IDLE;
+        int epoch = 0; // the mark bitmap of the current cycle
+
+    private:
+        static size_t align(size_t size) {
+            return (size + 7) & ~(size_t)7;
+        }
+        // allocate: a young object is preceded by its forwarding pointer.
+        void* allocate(size_t size) {
+            size = sizeof(Object*) + align(size);
+            if (top + size > nursery + NURSERY_SIZE) {
+                collect(); // the nursery is empty afterwards
             }
-            // now unmark all active objects
-            node = head;
-            while (node->next != nullptr) {
-                node->next->mark = false;
-                node = node->next;
+            *(Object**)top = nullptr;
+            void* memory = top + sizeof(Object*);
+            top += size;
+            return memory;
+        }
+        static Object*& forwarding(Object* obj) {
+            return *((Object**)obj - 1);
+        }
+        // allocateOld: a slot for an old object. The unswept pages of its pool are swept
+        // before the pool grows.
+        void* allocateOld(ObjType type) {
+            Pool& pool = pools[type];
+            while (!pool.hasFree() && !unswept[type].empty()) {
+                Page* page = unswept[type].back();
+                unswept[type].pop_back();
+                sweep(page);
+            }
+            return pool.allocate();
+        }
+        // blacken: mark an object the cycle in progress must not scan (or sweep).
+        void blacken(Object* obj) {
+            if (markerRunning) {
+                Page::of(obj)->testAndMarkAtomic(obj, epoch);
+            } else {
+                Page::of(obj)->testAndMark(obj, epoch);
             }
         }
+        static size_t heapSize(Object* obj);
+        void destroy(Object* obj) {
+            ObjType type = obj->type;
+            obj->destroy();
+            pools[type].free(obj);
+        }
+        void startCycle();
+        void markAll();
+        void startSweep();
+        void sweep(Page* page);
+        bool step(std::chrono::steady_clock::time_point deadline);
+        bool markSome(std::chrono::steady_clock::time_point deadline);
+        bool sweepSome(std::chrono::steady_clock::time_point deadline);
+        void finishCycle();
+        void startMarker();
+        void finishMarker();
+        void markConcurrently(std::vector<Object*>& work);
+        void markParallel(std::vector<Object*>& work);
+        void trace(Object* obj, std::vector<Object*>& work, std::vector<Value>& slots);
+        // lockEnvironments: hold envLock while the marker runs, to change the slots of an environment.
+        std::unique_lock<std::mutex> lockEnvironments() {
+            if (markerRunning) return std::unique_lock<std::mutex>(envLock);
+            return std::unique_lock<std::mutex>();
+        }
+        void scan(Object* obj);
+        void evacuate(Value& value);
+        void evacuateChildren(Object* obj);
+        void resetNursery();
+
+        char* nursery;
+        char* top;
+        std::vector<Environment*> remembered;
+        std::vector<Environment*> framePool; // released environments, kept marked
+        std::vector<Object*> promoted; // promoted objects whose children are not evacuated yet
+        Pool pools[TYPE_COUNT]; // old objects, by type
+        std::vector<Object*> gray; // marked objects whose children are not marked yet
+        std::vector<Page*> unswept[TYPE_COUNT]; // pages the sweep did not reach yet, by type
+
+        // concurrent marking
+        std::thread marker;
+        bool markerRunning = false; // only read and written by the interpreter thread
+        std::atomic<bool> markerDone{false};
+        std::mutex envLock; // resizing the slots of an environment, or scanning them
+        std::mutex shadedLock;
+        std::vector<Object*> shaded; // gray objects from the barrier, for the marker
+    };
+
+    /**
+     * RootScope: a handle scope. The values, lists and environments added through it
+     * are roots until the scope ends. Objects may move, so a pushed value must be read
+     * back with get() after anything that allocates.
+     */
+    class RootScope {
+    public:
+        RootScope(GarbageCollector& gc) : gc(gc) {
+            this->roots = gc.roots.size();
+            this->stacks = gc.stacks.size();
+            this->frames = gc.frames.size();
+        }
+        ~RootScope() {
+            gc.roots.resize(roots);
+            gc.stacks.resize(stacks);
+            gc.frames.resize(frames);
+        }
+        RootScope(const RootScope&) = delete;
+        RootScope& operator=(const RootScope&) = delete;
+
+        // push a value, returns its handle.
+        size_t push(Value value) {
+            gc.roots.emplace_back(value);
+            return gc.roots.size() - 1;
+        }
+        Value get(size_t handle) {
+            return gc.roots[handle];
+        }
+        // add a list of values, it must outlive the scope.
+        void add(std::vector<Value>& values) {
+            gc.stacks.emplace_back(&values);
+        }
+        // add the environment of a call.
+        void add(Environment* env) {
+            gc.frames.emplace_back(env);
+        }
 
-        Object* head;
+    private:
+        GarbageCollector& gc;
+        size_t roots;
+        size_t stacks;
+        size_t frames;
     };
 }
 
@@ -6,6 +6,7 @@
 #define CPP_LEXER_H
 
 #include <string>
+#include <string_view>
 #include "token.h"
 
 namespace corny {
@@ -14,17 +15,17 @@ namespace corny {
         Lexer() {};
         ~Lexer() {};
 
-        std::string input;
-        int pos = 0;
+        std::string_view input; // view over the source text, the lexer never copies it
+        size_t pos = 0;
         char current_char = '\0';
 
         // methods prototype
-        void start(std::string input);
+        void start(std::string_view input);
         static bool isDigit(char chr);
         static bool isAlpha(char chr);
         static bool isLetter(char chr);
         static bool isString(char chr);
-        std::string getNumber();
+        void skipDigits();
         void checkEOF();
         void advance();
         char peek();
@@ -33,6 +34,7 @@ namespace corny {
         Token parseInteger();
         Token parseString(char delimiter);
         Token parseIdent();
+        Token makeToken(TokenType type, size_t start);
         Token nextToken();
     };
 }
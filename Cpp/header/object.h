@@ -6,40 +6,43 @@
 #define CPP_OBJECT_H
 #include <iostream>
 #include <vector>
-#include <map>
-#include "environment.h"
 #include "ast.h"
+#include "table.h"
+#include "value.h"
 
 namespace corny {
-    enum ObjType {
-        OBJ_ERROR,
-        OBJ_NUMBER,
-        OBJ_BOOLEAN,
-        OBJ_STRING,
-        OBJ_NULL,
-        OBJ_FUNCTION,
-        OBJ_ARRAY,
-        OBJ_HASH,
-        OBJ_RETURN,
+    class FunctionProto; // compiled body, see code.h
+    class Environment;
+    // ObjSpace: where an object was allocated, see GarbageCollector.
+    enum ObjSpace : uint8_t {
+        SPACE_NONE,     // not managed by the GC (chunk constants, errors...)
+        SPACE_NURSERY,  // young object, bump allocated in the nursery
+        SPACE_OLD,      // promoted object, reclaimed by major collections
     };
-    // Object class where all system objects inherit from.
+    // Object class where all heap objects inherit from. Numbers, booleans and null
+    // are stored inline in a Value. The header is a single word holding the type tag
+    // and the GC space, there is no vtable: the methods below dispatch on the tag to
+    // the method of the same name of the concrete class (see object.cpp).
     class Object {
     public:
-        Object() {
-            this->next = nullptr;
-            this->mark = false;
-        }
-        ~Object() {}
         ObjType type;
-        Object* next;
-        bool mark;
-        virtual std::string Inspect() = 0;
+        ObjSpace space = SPACE_NONE;
+
+        std::string Inspect();
+        // byteSize: size of the concrete object, used to walk the nursery.
+        size_t byteSize();
+        // promote: move the object out of the nursery, into 'memory' (see Pool).
+        Object* promote(void* memory);
+        // destroy: run the destructor of the concrete object, its memory is left alone.
+        void destroy();
+        // free: destroy an object allocated with new, outside of the GC.
+        static void free(Object* obj);
     };
     // ErrorObj
     class ErrorObj : public Object {
     public:
         ErrorObj(std::string message) {
-            this->message = message;
+            this->message = std::move(message);
             this->type = OBJ_ERROR;
         }
         std::string message;
@@ -47,22 +50,8 @@ namespace corny {
         std::string Inspect() {
             return message;
         }
-    };
-    // ReturnObj
-    class ReturnObj : public Object {
-    public:
-        ReturnObj() {
-            this->type = OBJ_RETURN;
-        }
-        ReturnObj(Object* value) {
-            this->value = value;
-            this->type = OBJ_RETURN;
-        }
-
-        Object* value;
-        // inspect
-        std::string Inspect() {
-            return value->Inspect();
+        Object* promote(void* memory) {
+            return new (memory) ErrorObj(std::move(message));
         }
     };
     // FunctionObj
@@ -71,19 +60,29 @@ namespace corny {
         FunctionObj() {
             this->type = OBJ_FUNCTION;
         }
-        ~FunctionObj() {
-            for (auto parameter : parameters) {
-                delete parameter;
-            }
-            delete body;
-        }
+        ~FunctionObj(); // see object.cpp
         std::vector<IdentNode*> parameters;
-        BlockNode* body;
-        Environment *env;
+        BlockNode* body = nullptr;
+        ProgramNode* program = nullptr; // set when the function was created by the Evaluator
+        Environment *env = nullptr;
+        Scope* scope = nullptr; // slot layout of the function environment
+        FunctionProto* proto = nullptr; // set when the function was created by the VM
 
         std::string Inspect() {
             return "function: ok";
         }
+        Object* promote(void* memory) {
+            FunctionObj* functionObj = new (memory) FunctionObj();
+            functionObj->parameters = std::move(parameters);
+            functionObj->body = body;
+            functionObj->program = program;
+            functionObj->env = env;
+            functionObj->scope = scope;
+            functionObj->proto = proto;
+            program = nullptr; // the copy keeps the program retained
+            proto = nullptr; // and the script
+            return functionObj;
+        }
     };
     // ArrayObj
     class ArrayObj : public Object {
@@ -91,15 +90,17 @@ namespace corny {
         ArrayObj() {
             this->type = OBJ_ARRAY;
         }
-        ~ArrayObj() {
-            for (auto element : elements) {
-                delete element;
-            }
+        ArrayObj(std::vector<Value> elements) {
+            this->elements = std::move(elements);
+            this->type = OBJ_ARRAY;
         }
-        std::vector<Object*> elements;
+        std::vector<Value> elements; // the elements are owned by the GC, not by the array.
         std::string Inspect() {
             return "array";
         }
+        Object* promote(void* memory) {
+            return new (memory) ArrayObj(std::move(elements));
+        }
     };
     // HashObj
     class HashObj : public Object {
@@ -107,56 +108,17 @@ namespace corny {
         HashObj() {
             this->type = OBJ_HASH;
         }
-        ~HashObj() {
-            for (auto it = elements.begin(); it != elements.end();) {
-                delete it->second;
-                it = elements.erase(it);
-            }
+        HashObj(HashTable elements) {
+            this->elements = std::move(elements);
+            this->type = OBJ_HASH;
         }
-        std::map<std::string, Object*> elements;
+        HashTable elements; // the values are owned by the GC, not by the hash.
 
         std::string Inspect() {
             return "hash";
         }
-    };
-    // NumberObj
-    class NumberObj : public Object {
-    public:
-        NumberObj() {
-            this->type = OBJ_NUMBER;
-        }
-        NumberObj(double value) {
-            this->value = value;
-            this->type = OBJ_NUMBER;
-        }
-        double value = 0.0;
-        std::string Inspect() {
-            return std::to_string(value);
-        }
-    };
-    // BooleanObj
-    class BooleanObj : public Object {
-    public:
-        BooleanObj() {
-            this->type = OBJ_BOOLEAN;
-        }
-        BooleanObj(bool value) {
-            this->value = value;
-            this->type = OBJ_BOOLEAN;
-        }
-        bool value;
-        std::string Inspect() {
-            return (value == true) ? "true" : "false";
-        }
-    };
-    // NullObj
-    class NullObj : public Object {
-    public:
-        NullObj() {
-            this->type = OBJ_NULL;
-        }
-        std::string Inspect() {
-            return "null";
+        Object* promote(void* memory) {
+            return new (memory) HashObj(std::move(elements));
         }
     };
     // StringObj
@@ -166,14 +128,61 @@ namespace corny {
             this->type = OBJ_STRING;
         }
         StringObj(std::string value) {
-            this->value = value;
+            this->value = std::move(value);
             this->type = OBJ_STRING;
         }
+        // a string literal: its text and hash come from the symbol.
+        StringObj(const Symbol* symbol) {
+            this->value = symbol->name;
+            this->hash = symbol->hash;
+            this->symbol = symbol;
+            this->type = OBJ_STRING;
+        }
+        uint32_t hash = 0; // hashString(value), 0 until it is needed. It fits next to the header.
+        const Symbol* symbol = nullptr; // set when the string is interned
         std::string value;
         std::string Inspect() {
             return '\"'+ value + '\"';
         }
+        // hashCode: the value never changes, so its hash is computed once.
+        uint32_t hashCode() {
+            if (hash == 0) hash = hashString(value);
+            return hash;
+        }
+        Object* promote(void* memory) {
+            StringObj* stringObj = new (memory) StringObj(std::move(value));
+            stringObj->hash = hash;
+            stringObj->symbol = symbol;
+            return stringObj;
+        }
     };
+
+    // literalString: the StringObj of a string literal. It is created the first time the
+    // literal runs and shared by every evaluation after that, by both engines. It lives
+    // outside the GC (SPACE_NONE) as long as its symbol, forever.
+    inline StringObj* literalString(Symbol* symbol) {
+        if (symbol->literal == nullptr) symbol->literal = new StringObj(symbol);
+        return (StringObj*)symbol->literal;
+    }
+
+    static_assert(sizeof(ArrayObj) == 8 + sizeof(std::vector<Value>), "the object header must fit in a word");
+
+    // Value methods that need the Object layout.
+    inline ObjType Value::type() const {
+        if (isNumber()) return OBJ_NUMBER;
+        if (isBoolean()) return OBJ_BOOLEAN;
+        if (isObject()) return asObject()->type;
+        return OBJ_NULL;
+    }
+    inline bool Value::is(ObjType type) const {
+        return isObject() && asObject()->type == type;
+    }
+    inline std::string Value::inspect() const {
+        if (isNumber()) return std::to_string(asNumber());
+        if (isBoolean()) return asBoolean() ? "true" : "false";
+        if (isObject()) return asObject()->Inspect();
+        return "null";
+    }
 }
 
 #endif //CPP_OBJECT_H
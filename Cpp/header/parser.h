@@ -6,6 +6,7 @@
 #define CPP_PARSER_H
 #include "lexer.h"
 #include "ast.h"
+#include "source.h"
 
 namespace corny {
     class Parser {
@@ -14,15 +15,24 @@ namespace corny {
         Lexer lexer;
         Token curToken;
         Token peekToken;
+        Source* source = nullptr; // the text being parsed
+        ProgramNode* program = nullptr; // the program being parsed
+        // make: allocate a node in the arena of the current program.
+        template <class T, class... Args>
+        T* make(Args&&... args) {
+            return program->arena.make<T>(std::forward<Args>(args)...);
+        }
         // methods
-        void start(Lexer lexer);
+        void start(Source* source);
         void advance(TokenType type);
         void nextToken();
-        Node* parseProgram();
+        ProgramNode* parseProgram();
         Node* parseBlock();
         Node* parseStatement();
         Node* parseLetStatement();
         Node* parseReturnStatement();
+        Node* parseWhileStatement();
+        Node* parseForStatement();
         Node* parseExpression();
         Node* parseAssignment();
         Node* parseLogicOr();
@@ -0,0 +1,132 @@
+//
+// Created by irwin on 16/10/2026.
+//
+
+#ifndef CPP_POOL_H
+#define CPP_POOL_H
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+namespace corny {
+    /**
+     * Page: a PAGE_SIZE aligned chunk of fixed size slots. The header at the start of the
+     * page keeps one bit per slot: whether it holds an object, and whether the object was
+     * marked, for the two epochs the collector alternates between (see GarbageCollector).
+     */
+    struct Page {
+        static constexpr size_t SIZE = 64 * 1024;
+        static constexpr size_t MIN_SLOT = 16;
+        static constexpr size_t WORDS = SIZE / MIN_SLOT / 64; // bitmap words
+
+        uint32_t slotSize;
+        uint32_t slotCount;
+        char* slots; // first slot, right after the header
+        uint64_t allocated[WORDS];
+        uint64_t marks[2][WORDS];
+
+        // of: the page an old object lives in.
+        static Page* of(const void* memory) {
+            return (Page*)((uintptr_t)memory & ~(uintptr_t)(SIZE - 1));
+        }
+        size_t index(const void* memory) const {
+            return ((const char*)memory - slots) / slotSize;
+        }
+        void* slot(size_t index) const {
+            return slots + index * slotSize;
+        }
+        bool isMarked(const void* memory, int epoch) const {
+            size_t i = index(memory);
+            return (marks[epoch][i / 64] >> (i % 64)) & 1;
+        }
+        // testAndMark: set the mark bit, returns whether it was set already.
+        bool testAndMark(const void* memory, int epoch) {
+            size_t i = index(memory);
+            uint64_t bit = (uint64_t)1 << (i % 64);
+            uint64_t word = marks[epoch][i / 64];
+            marks[epoch][i / 64] = word | bit;
+            return word & bit;
+        }
+        // testAndMarkAtomic: the same, for marking threads.
+        bool testAndMarkAtomic(const void* memory, int epoch) {
+            size_t i = index(memory);
+            uint64_t bit = (uint64_t)1 << (i % 64);
+            return __atomic_fetch_or(&marks[epoch][i / 64], bit, __ATOMIC_RELAXED) & bit;
+        }
+    };
+
+    /**
+     * Pool: fixed size slots carved out of pages. Free slots are kept in an intrusive free
+     * list, so allocating and freeing are a couple of pointer moves. Pages are only given
+     * back when the pool is destroyed.
+     */
+    class Pool {
+    public:
+        Pool() {}
+        ~Pool() {
+            for (auto page : pages) {
+                std::free(page);
+            }
+        }
+        Pool(const Pool&) = delete;
+        Pool& operator=(const Pool&) = delete;
+
+        // init: every slot of the pool has room for 'size' bytes.
+        void init(size_t size) {
+            this->slotSize = (size + Page::MIN_SLOT - 1) & ~(Page::MIN_SLOT - 1);
+        }
+        bool hasFree() const {
+            return freeList != nullptr;
+        }
+        // allocate: a slot of uninitialized memory.
+        void* allocate() {
+            if (freeList == nullptr) grow();
+            FreeSlot* slot = freeList;
+            freeList = slot->next;
+            Page* page = Page::of(slot);
+            size_t i = page->index(slot);
+            page->allocated[i / 64] |= (uint64_t)1 << (i % 64);
+            return slot;
+        }
+        // free: the object in the slot must already be destroyed.
+        void free(void* memory) {
+            Page* page = Page::of(memory);
+            size_t i = page->index(memory);
+            page->allocated[i / 64] &= ~((uint64_t)1 << (i % 64));
+            FreeSlot* slot = (FreeSlot*)memory;
+            slot->next = freeList;
+            freeList = slot;
+        }
+
+        size_t slotSize = 0;
+        std::vector<Page*> pages;
+
+    private:
+        struct FreeSlot {
+            FreeSlot* next;
+        };
+        // grow: add a page, its slots are handed out from the lowest address up.
+        void grow() {
+            Page* page = (Page*)std::aligned_alloc(Page::SIZE, Page::SIZE);
+            if (page == nullptr) throw std::bad_alloc();
+            std::memset(page, 0, sizeof(Page));
+            size_t header = (sizeof(Page) + Page::MIN_SLOT - 1) & ~(Page::MIN_SLOT - 1);
+            page->slotSize = slotSize;
+            page->slotCount = (Page::SIZE - header) / slotSize;
+            page->slots = (char*)page + header;
+            pages.emplace_back(page);
+            for (size_t i = page->slotCount; i > 0; i--) {
+                FreeSlot* slot = (FreeSlot*)page->slot(i - 1);
+                slot->next = freeList;
+                freeList = slot;
+            }
+        }
+
+        FreeSlot* freeList = nullptr;
+    };
+}
+
+#endif //CPP_POOL_H
@@ -0,0 +1,36 @@
+//
+// Created by irwin on 16/10/2026.
+//
+
+#ifndef CPP_RESOLVER_H
+#define CPP_RESOLVER_H
+#include "ast.h"
+
+namespace corny {
+    /**
+     * Resolver: runs between the Parser and the evaluation. It gives every IdentNode
+     * and LetNode a lexical address (depth, slot) so environments can be plain slot
+     * arrays. Every 'let' of a function body is declared before the body is resolved,
+     * names that are not declared in any enclosing scope keep depth -1 and are looked
+     * up by name at runtime (e.g. globals defined in a later REPL line).
+     * It also flags the calls in tail position of every function body.
+     */
+    class Resolver {
+    public:
+        Resolver() {}
+        ~Resolver() {}
+
+        Scope globals; // shared by every program evaluated in the global environment.
+        std::vector<Scope*> scopes;
+
+        void resolve(ProgramNode* programNode);
+        void resolveNode(Node* node);
+        void resolveFunction(FunctionNode* functionNode);
+        void resolveIdent(IdentNode* identNode);
+        static void declareLets(Node* node, Scope& scope);
+        static void markTailCall(Node* node);
+        static void markReturns(Node* node);
+    };
+}
+
+#endif //CPP_RESOLVER_H
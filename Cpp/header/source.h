@@ -0,0 +1,42 @@
+//
+// Created by irwin on 16/10/2026.
+//
+
+#ifndef CPP_SOURCE_H
+#define CPP_SOURCE_H
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace corny {
+    /**
+     * Source: the text of a program. Tokens and AST nodes keep views into it, so it is
+     * owned by the ProgramNode and lives as long as the AST does. The text is either a
+     * REPL line kept in 'buffer' or a script file mapped straight into memory.
+     */
+    class Source {
+    public:
+        Source(std::string text) {
+            this->buffer = std::move(text);
+            this->data = buffer.data();
+            this->length = buffer.size();
+        }
+        ~Source();
+        Source(const Source&) = delete;
+        Source& operator=(const Source&) = delete;
+
+        // map a script file read-only, nullptr when it can not be opened.
+        static Source* map(const std::string& path);
+
+        std::string buffer;
+        const char* data = nullptr;
+        size_t length = 0;
+        bool mapped = false; // data points to a mapping that has to be released
+
+        std::string_view text() const {
+            return std::string_view(data, length);
+        }
+    };
+}
+
+#endif //CPP_SOURCE_H
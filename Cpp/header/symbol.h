@@ -0,0 +1,54 @@
+//
+// Created by irwin on 16/10/2026.
+//
+
+#ifndef CPP_SYMBOL_H
+#define CPP_SYMBOL_H
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "arena.h"
+#include "token.h"
+
+namespace corny {
+    class Object;
+
+    /**
+     * Symbol: an interned string. There is exactly one Symbol for every text that was
+     * interned, so two symbols are equal only when they are the same pointer. Symbols
+     * live as long as the process.
+     */
+    struct Symbol {
+        std::string name;
+        uint32_t hash;
+        TokenType keyword = TT_IDENT; // the token type when the text is a keyword
+        Object* literal = nullptr; // the StringObj of a string literal, see literalString()
+    };
+
+    /**
+     * SymbolTable: the intern table of identifiers, keywords and string literals. It
+     * is an open addressing set of symbols (linear probing), keyed by their hash.
+     */
+    class SymbolTable {
+    public:
+        SymbolTable();
+        SymbolTable(const SymbolTable&) = delete;
+        SymbolTable& operator=(const SymbolTable&) = delete;
+
+        // intern: the symbol for 'text', created the first time it is seen.
+        Symbol* intern(std::string_view text);
+
+    private:
+        void grow();
+
+        Arena arena; // the symbols
+        std::vector<Symbol*> buckets; // a power of two, nullptr when empty
+        size_t count = 0;
+    };
+
+    // intern: through the global table, shared by the lexer, the resolver and the runtime.
+    Symbol* intern(std::string_view text);
+}
+
+#endif //CPP_SYMBOL_H
@@ -0,0 +1,115 @@
+//
+// Created by irwin on 16/10/2026.
+//
+
+#ifndef CPP_TABLE_H
+#define CPP_TABLE_H
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "value.h"
+
+namespace corny {
+    struct Symbol;
+
+    // hashString: 32 bit FNV-1a.
+    inline uint32_t hashString(std::string_view text) {
+        uint32_t hash = 2166136261u;
+        for (unsigned char c : text) {
+            hash ^= c;
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    /**
+     * HashTable: string keys to Values, the storage of HashObj. Entries are kept in
+     * insertion order in a dense array and found through an open addressing index of
+     * entry positions (linear probing), so a lookup is one probe in the common case and
+     * a walk over the table touches contiguous memory. Every entry keeps the hash of its
+     * key, comparing keys is only needed when the hashes match, and not even then when
+     * both keys are interned: different symbols are different strings.
+     */
+    class HashTable {
+    public:
+        struct Entry {
+            uint32_t hash;
+            const Symbol* symbol; // nullptr unless the key is interned
+            std::string key;
+            Value value;
+        };
+
+        // find: the value bound to 'key', nullptr if there is none.
+        Value* find(std::string_view key, uint32_t hash, const Symbol* symbol) {
+            int32_t i = position(key, hash, symbol);
+            return (i < 0) ? nullptr : &entries[i].value;
+        }
+        // position: where 'key' is in entries, -1 if it is not there.
+        int32_t position(std::string_view key, uint32_t hash, const Symbol* symbol) const {
+            if (indices.empty()) return -1;
+            size_t mask = indices.size() - 1;
+            for (size_t i = hash & mask; indices[i] != EMPTY; i = (i + 1) & mask) {
+                const Entry& entry = entries[indices[i]];
+                if (entry.hash != hash) continue;
+                if (symbol != nullptr && entry.symbol != nullptr) {
+                    if (entry.symbol == symbol) return indices[i];
+                } else if (entry.key == key) {
+                    return indices[i];
+                }
+            }
+            return -1;
+        }
+        // set: bind 'key', a key that is already there keeps its position.
+        void set(std::string key, uint32_t hash, const Symbol* symbol, Value value) {
+            Value* existing = find(key, hash, symbol);
+            if (existing != nullptr) {
+                *existing = value;
+                return;
+            }
+            // keep the load factor under 3/4.
+            if ((entries.size() + 1) * 4 > indices.size() * 3) rehash(indices.empty() ? 8 : indices.size() * 2);
+            entries.push_back(Entry{hash, symbol, std::move(key), value});
+            insert(hash, entries.size() - 1);
+        }
+        // reserve: room for 'count' keys without rehashing.
+        void reserve(size_t count) {
+            entries.reserve(count);
+            size_t size = 8;
+            while (count * 4 > size * 3) size *= 2;
+            if (size > indices.size()) rehash(size);
+        }
+        size_t size() const {
+            return entries.size();
+        }
+        std::vector<Entry>::iterator begin() {
+            return entries.begin();
+        }
+        std::vector<Entry>::iterator end() {
+            return entries.end();
+        }
+
+        std::vector<Entry> entries; // in insertion order
+        std::vector<int32_t> indices; // a power of two, EMPTY or a position in entries
+
+    private:
+        static constexpr int32_t EMPTY = -1;
+
+        void insert(uint32_t hash, int32_t position) {
+            size_t mask = indices.size() - 1;
+            size_t i = hash & mask;
+            while (indices[i] != EMPTY) {
+                i = (i + 1) & mask;
+            }
+            indices[i] = position;
+        }
+        void rehash(size_t size) {
+            indices.assign(size, EMPTY);
+            for (size_t i = 0; i < entries.size(); i++) {
+                insert(entries[i].hash, i);
+            }
+        }
+    };
+}
+
+#endif //CPP_TABLE_H
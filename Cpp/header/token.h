@@ -4,7 +4,9 @@
 
 #ifndef CPP_TOKEN_H
 #define CPP_TOKEN_H
-#include <map>
+#include <cstddef>
+#include <string>
+#include <string_view>
 
 namespace corny {
     const char NONE = '\0';
@@ -62,32 +64,40 @@ namespace corny {
         TT_RETURN,
         TT_IF,
         TT_ELSE,
+        TT_WHILE,
+        TT_FOR,
+        TT_IN,
     };
-    // keywords dictionary: we need to be able to identify an identifier from a keyword.
-    extern std::map<std::string, TokenType> keywords;
+    // keywords: we need to be able to identify an identifier from a keyword. They are
+    // interned with their token type by the SymbolTable.
+    struct Keyword {
+        const char* name;
+        TokenType type;
+    };
+    extern const Keyword keywords[];
+    extern const size_t keywordCount;
+    struct Symbol;
 
     /**
      * Token class: the building block of every programming language.
+     * The literal is a view into the source text, tokens never copy characters.
+     * Identifiers, keywords and strings also carry their interned Symbol.
      */
     class Token {
     public:
         Token() {};
-        Token(TokenType type, std::string literal) {
+        Token(TokenType type, std::string_view literal) {
             this->type = type;
             this->literal = literal;
         }
-        Token(TokenType type, char literal) {
-            this->type = type;
-            this->literal = std::string(1, literal);
-        }
-        ~Token(){};
 
-        TokenType type;
-        std::string literal;
+        TokenType type = TT_EOF;
+        std::string_view literal;
+        Symbol* symbol = nullptr;
     };
 
     // isKeyword: check if 'ident' is a keyword or a ident token.
-    TokenType isKeyword(std::string ident);
+    TokenType isKeyword(std::string_view ident);
 }
 
 #endif //CPP_TOKEN_H
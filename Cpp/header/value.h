@@ -0,0 +1,130 @@
+//
+// Created by irwin on 16/10/2026.
+//
+
+#ifndef CPP_VALUE_H
+#define CPP_VALUE_H
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace corny {
+    enum ObjType : uint8_t {
+        OBJ_ERROR,
+        OBJ_NUMBER,
+        OBJ_BOOLEAN,
+        OBJ_STRING,
+        OBJ_NULL,
+        OBJ_FUNCTION,
+        OBJ_ARRAY,
+        OBJ_HASH,
+        OBJ_ENVIRONMENT, // internal, never stored in a Value
+    };
+    class Object;
+
+    /**
+     * Value: a NaN-boxed 64 bit value. Numbers are stored as plain doubles, booleans
+     * and null live inside the quiet NaN space and everything else is a pointer to a
+     * heap Object (tagged with the sign bit).
+     */
+    class Value {
+    public:
+        static const uint64_t SIGN_BIT = 0x8000000000000000ULL;
+        static const uint64_t QNAN = 0x7ffc000000000000ULL;
+        static const uint64_t TAG_NULL = 1;
+        static const uint64_t TAG_FALSE = 2;
+        static const uint64_t TAG_TRUE = 3;
+        static const uint64_t TAG_EMPTY = 4; // an unbound slot, never visible to CornyLang code.
+        // completion signals: a 'return', an error or a tail call travelling up to whoever
+        // handles it. Their payload is kept by the interpreter, so signalling never allocates.
+        static const uint64_t TAG_RETURN = 8;
+        static const uint64_t TAG_ERROR = 9;
+        static const uint64_t TAG_TAIL_CALL = 10;
+
+        Value() {
+            this->bits = QNAN | TAG_NULL;
+        }
+
+        uint64_t bits;
+
+        // constructors
+        static Value number(double number) {
+            Value value;
+            std::memcpy(&value.bits, &number, sizeof(double));
+            return value;
+        }
+        static Value boolean(bool boolean) {
+            return fromBits(QNAN | (boolean ? TAG_TRUE : TAG_FALSE));
+        }
+        static Value null() {
+            return fromBits(QNAN | TAG_NULL);
+        }
+        static Value empty() {
+            return fromBits(QNAN | TAG_EMPTY);
+        }
+        static Value signal(uint64_t tag) {
+            return fromBits(QNAN | tag);
+        }
+        static Value object(Object* obj) {
+            return fromBits(SIGN_BIT | QNAN | (uint64_t)(uintptr_t)obj);
+        }
+        static Value fromBits(uint64_t bits) {
+            Value value;
+            value.bits = bits;
+            return value;
+        }
+
+        // type checks
+        bool isNumber() const {
+            return (bits & QNAN) != QNAN;
+        }
+        bool isBoolean() const {
+            return (bits | 1) == (QNAN | TAG_TRUE);
+        }
+        bool isNull() const {
+            return bits == (QNAN | TAG_NULL);
+        }
+        bool isEmpty() const {
+            return bits == (QNAN | TAG_EMPTY);
+        }
+        bool isSignal() const {
+            return (bits | 3) == (QNAN | 11); // TAG_RETURN up to 11
+        }
+        bool isReturn() const {
+            return bits == (QNAN | TAG_RETURN);
+        }
+        bool isError() const {
+            return bits == (QNAN | TAG_ERROR);
+        }
+        bool isObject() const {
+            return (bits & (QNAN | SIGN_BIT)) == (QNAN | SIGN_BIT);
+        }
+
+        // accessors
+        double asNumber() const {
+            double number;
+            std::memcpy(&number, &bits, sizeof(double));
+            return number;
+        }
+        bool asBoolean() const {
+            return bits == (QNAN | TAG_TRUE);
+        }
+        Object* asObject() const {
+            return (Object*)(uintptr_t)(bits & ~(SIGN_BIT | QNAN));
+        }
+
+        // defined in object.h
+        inline ObjType type() const;
+        inline bool is(ObjType type) const;
+        inline std::string inspect() const;
+
+        bool operator==(const Value& other) const {
+            return bits == other.bits;
+        }
+        bool operator!=(const Value& other) const {
+            return bits != other.bits;
+        }
+    };
+}
+
+#endif //CPP_VALUE_H
@@ -0,0 +1,72 @@
+//
+// Created by irwin on 16/10/2026.
+//
+
+#ifndef CPP_VM_H
+#define CPP_VM_H
+
+#include "object.h"
+#include "code.h"
+#include "environment.h"
+#include "gc.h"
+
+namespace corny {
+    // CallFrame: an active function invocation.
+    class CallFrame {
+    public:
+        FunctionProto* proto;
+        size_t ip;
+        Environment* env;
+        size_t base; // stack index of the callee, the frame's values start right after it.
+    };
+
+    /**
+     * VM: stack based interpreter for the bytecode produced by the Compiler.
+     * It gives the same results as the Evaluator.
+     */
+    class VM {
+    public:
+        VM() {
+            stack.reserve(256);
+            gc.stacks.emplace_back(&stack); // every value on the stack is a root
+        }
+        ~VM() {}
+
+        const Value TRUE = Value::boolean(true);
+        const Value FALSE = Value::boolean(false);
+        const Value NIL = Value::null();
+
+        static constexpr size_t MAX_DEPTH = 1000000; // nested calls, frames live on the heap
+        size_t maxDepth = MAX_DEPTH;
+
+        std::string errorMessage; // payload of an error signal, see Value::TAG_ERROR
+
+        static bool isError(Value value);
+        Value newError(std::string message);
+        Value run(FunctionProto* proto, Environment* env);
+        Value execute();
+        Value callValue(Value calleeObj, int argc);
+        Value binaryOp(OpCode opCode, Value leftObj, Value rightObj);
+        Value accessValue(Value calleeObj, int argc, InlineCache& cache);
+        void push(Value value) {
+            stack.emplace_back(value);
+        }
+        Value pop() {
+            Value value = stack.back();
+            stack.pop_back();
+            return value;
+        }
+        Value peek(int distance) {
+            return stack[stack.size() - 1 - distance];
+        }
+        Value runtimeError(std::string message);
+        Value fail();
+
+        std::vector<Value> stack;
+        std::vector<CallFrame> frames;
+
+        GarbageCollector gc;
+    };
+}
+
+#endif //CPP_VM_H
@@ -1,4 +1,6 @@
 #include <iostream>
+#include <chrono>
+#include <cstdlib>
 #include <ctime>
 #include <string>
 
@@ -6,9 +8,109 @@
 #include "header/parser.h"
 #include "header/evaluator.h"
 #include "header/environment.h"
+#include "header/resolver.h"
+#include "header/source.h"
+#include "header/compiler.h"
+#include "header/vm.h"
 #include <vector>
 
-int main() {
+// milliseconds elapsed between two points of the steady clock.
+static double elapsed(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// command line options shared by the REPL and the script mode.
+struct Options {
+    std::string engine = "eval";
+    size_t heapTarget = corny::GarbageCollector::HEAP_TARGET;
+    std::chrono::microseconds gcPause{0}; // 0: stop the world
+    bool gcConcurrent = false;
+    int gcThreads = 1;
+    bool stackless = false;
+    size_t maxDepth = 0; // 0: the default of the engine
+};
+
+// Engine: the evaluator or the VM, whichever the options select. Only that one is created,
+// with its own collector, and it owns the global environment.
+class Engine {
+public:
+    Engine(const Options& options, corny::Resolver& resolver) {
+        if (options.engine == "vm") {
+            vm = new corny::VM();
+            if (options.maxDepth > 0) vm->maxDepth = options.maxDepth;
+            gc = &vm->gc;
+        } else {
+            evaluator = new corny::Evaluator();
+            evaluator->stackless = options.stackless;
+            if (options.stackless) evaluator->maxDepth = corny::Evaluator::STACKLESS_MAX_DEPTH;
+            if (options.maxDepth > 0) evaluator->maxDepth = options.maxDepth;
+            gc = &evaluator->gc;
+        }
+        gc->setHeapTarget(options.heapTarget);
+        gc->setPauseBudget(options.gcPause);
+        gc->setConcurrent(options.gcConcurrent);
+        gc->setMarkThreads(options.gcThreads);
+        globalEnv = gc->newEnvironment(&resolver.globals, nullptr);
+    }
+    Engine(const Engine&) = delete;
+    ~Engine() {
+        delete evaluator;
+        delete vm;
+    }
+    // run: evaluate a resolved program, or compile it to bytecode and run it on the VM.
+    corny::Value run(corny::ProgramNode* program) {
+        if (vm == nullptr) {
+            corny::Value evaluated = evaluator->eval(program, globalEnv);
+            program->release(); // freed now unless one of its functions is still alive
+            return evaluated;
+        }
+        corny::FunctionProto* proto = compiler.compile(program);
+        program->release(); // the bytecode does not need the AST
+        corny::Value evaluated = vm->run(proto, globalEnv);
+        proto->release(); // freed now unless one of its functions is still alive
+        return evaluated;
+    }
+
+private:
+    corny::Evaluator* evaluator = nullptr;
+    corny::VM* vm = nullptr;
+    corny::Compiler compiler;
+    corny::GarbageCollector* gc;
+    corny::Environment* globalEnv;
+};
+
+// runFile: evaluate a whole script in one pass and report where the time went.
+static int runFile(const std::string& path, const Options& options) {
+    auto totalStart = std::chrono::steady_clock::now();
+    corny::Source* source = corny::Source::map(path);
+    if (source == nullptr) {
+        std::cout << "Could not open file: " << path << std::endl;
+        return 1;
+    }
+    corny::Parser parser;
+    corny::Resolver resolver;
+    Engine engine(options, resolver);
+
+    // lexing, parsing and resolving
+    auto parseStart = std::chrono::steady_clock::now();
+    parser.start(source);
+    corny::ProgramNode* program = parser.parseProgram();
+    resolver.resolve(program);
+    auto parseEnd = std::chrono::steady_clock::now();
+
+    // compiling (vm only) and running
+    corny::Value evaluated = engine.run(program);
+    auto evalEnd = std::chrono::steady_clock::now();
+    std::cout << evaluated.inspect() << std::endl;
+
+    // timings go to stderr so they never mix with the program output.
+    std::cerr << "parse: " << elapsed(parseStart, parseEnd) << " ms" << std::endl;
+    std::cerr << "eval: " << elapsed(parseEnd, evalEnd) << " ms" << std::endl;
+    std::cerr << "total: " << elapsed(totalStart, std::chrono::steady_clock::now()) << " ms" << std::endl;
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
     const std::string PROGRAM = "CornyLang";
     const std::string VERSION = "1.0.1";
     const std::string WELCOME = "Please feel free to type some valid commands or expressions!";
@@ -23,6 +125,70 @@ int main() {
 \_|    )_-\ \_-`
 `-----` `--`)V0G0N";
     const std::string OUTPUT = "";
+    // select the engine: the tree walking evaluator (default) or the bytecode VM.
+    Options options;
+    std::vector<std::string> commands;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--engine=", 0) == 0) {
+            options.engine = arg.substr(9);
+        } else if (arg.rfind("--heap-target=", 0) == 0) {
+            // old generation size (in MB) that starts a major collection.
+            int megabytes = std::atoi(arg.c_str() + 14);
+            if (megabytes <= 0) {
+                std::cout << "Invalid heap target: " << arg.substr(14) << std::endl;
+                return 1;
+            }
+            options.heapTarget = (size_t)megabytes * 1024 * 1024;
+        } else if (arg.rfind("--gc-pause=", 0) == 0) {
+            // pause budget (in microseconds) of the incremental major collection.
+            int microseconds = std::atoi(arg.c_str() + 11);
+            if (microseconds < 0 || arg.size() == 11) {
+                std::cout << "Invalid pause budget: " << arg.substr(11) << std::endl;
+                return 1;
+            }
+            options.gcPause = std::chrono::microseconds(microseconds);
+        } else if (arg.rfind("--gc-threads=", 0) == 0) {
+            // threads that mark the old generation in parallel.
+            int threads = std::atoi(arg.c_str() + 13);
+            if (threads <= 0) {
+                std::cout << "Invalid number of threads: " << arg.substr(13) << std::endl;
+                return 1;
+            }
+            options.gcThreads = threads;
+        } else if (arg.rfind("--max-depth=", 0) == 0) {
+            // nested calls allowed before the program stops with an error.
+            long depth = std::atol(arg.c_str() + 12);
+            if (depth <= 0) {
+                std::cout << "Invalid maximum depth: " << arg.substr(12) << std::endl;
+                return 1;
+            }
+            options.maxDepth = depth;
+        } else if (arg == "--stackless") {
+            // the evaluator keeps its calls on the heap instead of the native stack.
+            options.stackless = true;
+        } else if (arg == "--gc-concurrent") {
+            // mark the old generation on a background thread.
+            options.gcConcurrent = true;
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cout << "Unknown option: " << arg << std::endl;
+            return 1;
+        } else {
+            commands.emplace_back(arg);
+        }
+    }
+    if (options.engine != "eval" && options.engine != "vm") {
+        std::cout << "Unknown engine: " << options.engine << " (use --engine=eval or --engine=vm)" << std::endl;
+        return 1;
+    }
+    // corny run <file>: execute a script instead of starting the REPL.
+    if (!commands.empty()) {
+        if (commands.size() == 2 && commands[0] == "run") {
+            return runFile(commands[1], options);
+        }
+        std::cout << "Usage: corny [--engine=eval|vm] [--heap-target=<MB>] [--gc-pause=<us>] [--gc-concurrent] [--gc-threads=<n>] [--stackless] [--max-depth=<n>] [run <file>]" << std::endl;
+        return 1;
+    }
     time_t TIME;
     std::time(&TIME);
     std::cout << PROGRAM << " v" << VERSION;
@@ -31,10 +197,9 @@ int main() {
     std::string input;
 
     // create global variables
-    corny::Lexer lexer;
     corny::Parser parser;
-    corny::Evaluator evaluator;
-    corny::Environment *globalEnv = new corny::Environment();
+    corny::Resolver resolver;
+    Engine engine(options, resolver);
 
     // start the REPL
     while (true) {
@@ -42,23 +207,17 @@ int main() {
         std::getline(std::cin, input);
         if (input.empty())
             break;
-        lexer.start(input);
-        parser.start(lexer);
+        // the program keeps the source text, tokens are views into it.
+        parser.start(new corny::Source(input));
 
-        // lexical analysis
-        //corny::Lexer lexer(input);
-        // syntax analysis
-        //corny::Parser parser(lexer);
         // parse the syntax and generate AST node.
-        corny::Node* program = parser.parseProgram();
-        // evaluator
-        //corny::Evaluator evaluator;
+        corny::ProgramNode* program = parser.parseProgram();
+        // give every variable its lexical address
+        resolver.resolve(program);
         // evaluate the node
-        corny::Object* evaluated = evaluator.eval(program, globalEnv);
+        corny::Value evaluated = engine.run(program);
         // inspect the object and print out the result
-        if (evaluated != nullptr) {
-            std::cout << evaluated->Inspect() << std::endl;
-        }
+        std::cout << evaluated.inspect() << std::endl;
     }
     return 0;
 }
@@ -0,0 +1,259 @@
+//
+// Created by irwin on 16/10/2026.
+//
+#include "../header/compiler.h"
+
+namespace corny {
+    // error: compile errors are fatal, just like parse errors.
+    void Compiler::error(std::string message) {
+        std::cout << "Compiler Error: " << message << std::endl;
+        std::exit(1);
+    }
+    // compile: the whole program becomes the body of a parameterless function.
+    // The caller releases the proto once it is done running it.
+    FunctionProto* Compiler::compile(ProgramNode *programNode) {
+        FunctionProto* proto = new FunctionProto();
+        script = proto;
+        compileStatements(programNode->statements, proto->chunk);
+        proto->chunk.write(OP_RETURN);
+        return proto;
+    }
+    // compileStatements: every statement leaves one value, only the last one is kept.
+    void Compiler::compileStatements(std::vector<Node*>& statements, Chunk& chunk) {
+        if (statements.empty()) {
+            chunk.write(OP_NULL);
+            return;
+        }
+        for (size_t i = 0; i < statements.size(); i++) {
+            if (i > 0) chunk.write(OP_POP);
+            compileNode(statements[i], chunk);
+        }
+    }
+    // compileNode
+    void Compiler::compileNode(Node *node, Chunk& chunk) {
+        switch (node->type) {
+            case NT_PROGRAM:
+                compileStatements(((ProgramNode*)node)->statements, chunk);
+                break;
+            case NT_BLOCK:
+                compileStatements(((BlockNode*)node)->statements, chunk);
+                break;
+            case NT_NUMBER:
+                chunk.write(OP_CONSTANT);
+                writeOperand(chunk.addConstant(Value::number(((NumberNode*)node)->value)), "constants in one function", chunk);
+                break;
+            case NT_STRING:
+                chunk.write(OP_CONSTANT);
+                writeOperand(chunk.addConstant(Value::object(literalString(((StringNode*)node)->symbol))), "constants in one function", chunk);
+                break;
+            case NT_BOOLEAN:
+                chunk.write(((BooleanNode*)node)->value ? OP_TRUE : OP_FALSE);
+                break;
+            case NT_NULL:
+                chunk.write(OP_NULL);
+                break;
+            case NT_UNARY:
+            {
+                UnaryNode* unaryNode = (UnaryNode*)node;
+                compileNode(unaryNode->left, chunk);
+                if (unaryNode->opToken.type == TT_MINUS) chunk.write(OP_NEGATE);
+                else if (unaryNode->opToken.type == TT_NOT) chunk.write(OP_NOT);
+                else error("Invalid operator: " + std::string(unaryNode->opToken.literal));
+                break;
+            }
+            case NT_BINARY:
+                compileBinary((BinOpNode*)node, chunk);
+                break;
+            case NT_LET:
+            {
+                LetNode* letNode = (LetNode*)node;
+                compileNode(letNode->value, chunk);
+                chunk.write(OP_SET_SLOT);
+                writeOperand(letNode->ident->slot, "variables in one function", chunk);
+                break;
+            }
+            case NT_RETURN:
+                compileNode(((ReturnNode*)node)->value, chunk);
+                chunk.write(OP_RETURN);
+                break;
+            case NT_IDENT:
+            {
+                IdentNode* identNode = (IdentNode*)node;
+                if (identNode->depth >= 0 && identNode->depth <= UINT8_MAX) {
+                    chunk.write(OP_GET_SLOT);
+                    chunk.write(identNode->depth);
+                    writeOperand(identNode->slot, "variables in one function", chunk);
+                } else {
+                    chunk.write(OP_GET_NAME);
+                }
+                writeOperand(chunk.addName(identNode->value.symbol), "names in one function", chunk);
+                break;
+            }
+            case NT_ARRAY:
+                compileArray((ArrayNode*)node, chunk);
+                break;
+            case NT_HASH:
+                compileHash((HashNode*)node, chunk);
+                break;
+            case NT_CALL:
+                compileCall((CallExprNode*)node, chunk);
+                break;
+            case NT_FUNCTION:
+                compileFunction((FunctionNode*)node, chunk);
+                break;
+            case NT_IF:
+                compileIf((IfNode*)node, chunk);
+                break;
+            case NT_WHILE:
+                compileWhile((WhileNode*)node, chunk);
+                break;
+            case NT_FOR:
+                compileFor((ForNode*)node, chunk);
+                break;
+            default:
+                error("Unknown Node type.");
+        }
+    }
+    // compileBinary
+    void Compiler::compileBinary(BinOpNode *binOpNode, Chunk& chunk) {
+        TokenType type = binOpNode->opToken.type;
+        if (type == TT_AND || type == TT_OR) {
+            compileLogical(binOpNode, chunk);
+            return;
+        }
+        compileNode(binOpNode->left, chunk);
+        compileNode(binOpNode->right, chunk);
+        switch (type) {
+            case TT_PLUS: chunk.write(OP_ADD); break;
+            case TT_MINUS: chunk.write(OP_SUB); break;
+            case TT_MUL: chunk.write(OP_MUL); break;
+            case TT_DIV: chunk.write(OP_DIV); break;
+            case TT_LESS: chunk.write(OP_LESS); break;
+            case TT_LESS_EQ: chunk.write(OP_LESS_EQ); break;
+            case TT_GREATER: chunk.write(OP_GREATER); break;
+            case TT_GREATER_EQ: chunk.write(OP_GREATER_EQ); break;
+            case TT_EQUAL: chunk.write(OP_EQUAL); break;
+            case TT_NOT_EQ: chunk.write(OP_NOT_EQ); break;
+            default:
+                error("Invalid operator: " + std::string(binOpNode->opToken.literal));
+        }
+    }
+    // compileLogical: 'and'/'or' short-circuit over the left operand.
+    void Compiler::compileLogical(BinOpNode *binOpNode, Chunk& chunk) {
+        compileNode(binOpNode->left, chunk);
+        int endJump = emitJump(binOpNode->opToken.type == TT_AND ? OP_AND : OP_OR, chunk);
+        compileNode(binOpNode->right, chunk);
+        chunk.write(OP_CHECK_BOOL);
+        patchJump(endJump, chunk);
+    }
+    // compileIf
+    void Compiler::compileIf(IfNode *ifNode, Chunk& chunk) {
+        compileNode(ifNode->condition, chunk);
+        int elseJump = emitJump(OP_JUMP_IF_FALSE, chunk);
+        compileNode(ifNode->consequence, chunk);
+        int endJump = emitJump(OP_JUMP, chunk);
+        patchJump(elseJump, chunk);
+        if (ifNode->alternative != nullptr) {
+            compileNode(ifNode->alternative, chunk);
+        } else {
+            chunk.write(OP_NULL);
+        }
+        patchJump(endJump, chunk);
+    }
+    // compileWhile: the value of the body is dropped on every iteration, the loop leaves null.
+    void Compiler::compileWhile(WhileNode *whileNode, Chunk& chunk) {
+        int loopStart = chunk.code.size();
+        compileNode(whileNode->condition, chunk);
+        int exitJump = emitJump(OP_WHILE, chunk);
+        compileStatements(whileNode->body->statements, chunk);
+        chunk.write(OP_POP);
+        emitLoop(loopStart, chunk);
+        patchJump(exitJump, chunk);
+        chunk.write(OP_NULL);
+    }
+    // compileFor: the array and the index of the next element stay on the stack during the loop.
+    void Compiler::compileFor(ForNode *forNode, Chunk& chunk) {
+        compileNode(forNode->iterable, chunk);
+        chunk.write(OP_CONSTANT);
+        chunk.writeShort(chunk.addConstant(Value::number(0)));
+        int loopStart = chunk.code.size();
+        chunk.write(OP_FOR);
+        chunk.writeShort(forNode->ident->slot);
+        int exitJump = chunk.code.size();
+        chunk.writeShort(0xffff);
+        compileStatements(forNode->body->statements, chunk);
+        chunk.write(OP_POP);
+        emitLoop(loopStart, chunk);
+        patchJump(exitJump, chunk);
+        chunk.write(OP_NULL);
+    }
+    // compileCall: function calls, array, hash and string subscripts share OP_CALL.
+    void Compiler::compileCall(CallExprNode *callExprNode, Chunk& chunk) {
+        compileNode(callExprNode->callee, chunk);
+        if (callExprNode->arguments.size() > UINT8_MAX) error("Too many arguments in call expression.");
+        for (auto argument : callExprNode->arguments) {
+            compileNode(argument, chunk);
+        }
+        chunk.write(callExprNode->tail ? OP_TAIL_CALL : OP_CALL);
+        chunk.write(callExprNode->arguments.size());
+        writeOperand(chunk.addCache(), "calls in one function", chunk);
+    }
+    // compileFunction
+    void Compiler::compileFunction(FunctionNode *functionNode, Chunk& chunk) {
+        FunctionProto* proto = new FunctionProto();
+        proto->script = script;
+        for (auto parameter : functionNode->parameters) {
+            proto->parameters.emplace_back(parameter->slot);
+        }
+        proto->scope = functionNode->scope;
+        compileStatements(functionNode->body->statements, proto->chunk);
+        proto->chunk.write(OP_RETURN);
+
+        chunk.functions.emplace_back(proto);
+        chunk.write(OP_CLOSURE);
+        writeOperand(chunk.functions.size() - 1, "function literals in one function", chunk);
+    }
+    // compileArray
+    void Compiler::compileArray(ArrayNode *arrayNode, Chunk& chunk) {
+        for (auto element : arrayNode->elements) {
+            compileNode(element, chunk);
+        }
+        chunk.write(OP_ARRAY);
+        writeOperand(arrayNode->elements.size(), "elements in an array literal", chunk);
+    }
+    // compileHash: keys are validated as soon as they are evaluated.
+    void Compiler::compileHash(HashNode *hashNode, Chunk& chunk) {
+        for (size_t i = 0; i < hashNode->keys.size(); i++) {
+            compileNode(hashNode->keys.at(i), chunk);
+            chunk.write(OP_HASH_KEY);
+            compileNode(hashNode->values.at(i), chunk);
+        }
+        chunk.write(OP_HASH);
+        writeOperand(hashNode->keys.size(), "keys in a hash literal", chunk);
+    }
+    // writeOperand: a u16 operand, compiling fails instead of truncating it.
+    void Compiler::writeOperand(size_t value, const std::string& what, Chunk& chunk) {
+        if (value > UINT16_MAX) error("Too many " + what + ".");
+        chunk.writeShort(value);
+    }
+    // emitJump: write a jump with a placeholder offset and return the operand position.
+    int Compiler::emitJump(OpCode opCode, Chunk& chunk) {
+        chunk.write(opCode);
+        chunk.writeShort(0xffff);
+        return chunk.code.size() - 2;
+    }
+    // patchJump: point the jump at 'offset' to the current end of the chunk.
+    void Compiler::patchJump(int offset, Chunk& chunk) {
+        int jump = chunk.code.size() - offset - 2;
+        if (jump > UINT16_MAX) error("Too much code to jump over.");
+        chunk.code[offset] = (jump >> 8) & 0xff;
+        chunk.code[offset + 1] = jump & 0xff;
+    }
+    // emitLoop: jump back to 'loopStart', the offset counts from the end of the instruction.
+    void Compiler::emitLoop(int loopStart, Chunk& chunk) {
+        chunk.write(OP_LOOP);
+        int jump = chunk.code.size() - loopStart + 2;
+        if (jump > UINT16_MAX) error("Loop body too large.");
+        chunk.writeShort(jump);
+    }
+}
@@ -1,33 +1,26 @@
 //
 // Created by irwin on 13/05/2021.
 //
+#include <sys/resource.h>
 #include "../header/evaluator.h"
 
 namespace corny {
-    // check whether passed object is null or ErrorObj type.
-    bool Evaluator::isError(Object *obj) {
-        return obj != nullptr && obj->type == OBJ_ERROR;
+    // isAbrupt: a 'return' or an error, the evaluation stops and the signal goes up.
+    bool Evaluator::isAbrupt(Value value) {
+        return value.isSignal();
+    }
+    // newError: signal an error. The ErrorObj is only created if the program ends with it.
+    Value Evaluator::newError(std::string message) {
+        errorMessage = std::move(message);
+        return Value::signal(Value::TAG_ERROR);
     }
     // evalStatements
-    Object* Evaluator::evalStatements(std::vector<Node*> statements, Environment *env) {
-        Object* resultObj;
+    Value Evaluator::evalStatements(std::vector<Node*>& statements, Environment *env) {
+        Value resultObj = NIL; // an empty block evaluates to null
         for (auto statement : statements) {
             resultObj = eval(statement, env);
-            gc.mark(resultObj); // set the mark to true.
-            // if it is a OBJ_RETURN then mark the value
-            if (resultObj->type == OBJ_RETURN) {
-                gc.mark(((ReturnObj*)resultObj)->value);
-            }
-            // now increase the gcCounter
-            gcCounter += 1;
-            // check for the limit and sweep
-            if (gcCounter == gcMaxObjects) {
-                gc.mark(env); // mark the symbol table.
-                gc.sweep(); // start sweeping all objects.
-                gcCounter = 0; // restart the objects counter.
-            }
 
-            if (resultObj->type == OBJ_RETURN || resultObj->type == OBJ_ERROR) {
+            if (isAbrupt(resultObj)) {
                 return resultObj;
             }
         }
@@ -35,7 +28,7 @@ namespace corny {
         return resultObj;
     }
     // recursively evaluates the current node.
-    Object* Evaluator::eval(Node *node, Environment *env) {
+    Value Evaluator::eval(Node *node, Environment *env) {
         NodeType type = node->type;
         switch(type) {
             case NT_PROGRAM:
@@ -45,11 +38,7 @@ namespace corny {
             case NT_BOOLEAN:
                 return (((BooleanNode*)node)->value) ? TRUE : FALSE;
             case NT_NUMBER:
-            {
-                NumberObj* numberObj = new NumberObj(((NumberNode*)node)->value);
-                gc.add(numberObj);
-                return numberObj;
-            }
+                return Value::number(((NumberNode*)node)->value);
             case NT_NULL:
                 return NIL;
             case NT_UNARY:
@@ -57,11 +46,7 @@ namespace corny {
             case NT_BINARY:
                 return evalBinaryExpression((BinOpNode*)node, env);
             case NT_STRING:
-            {
-                StringObj* stringObj = new StringObj(((StringNode*)node)->value);
-                gc.add(stringObj);
-                return stringObj;
-            }
+                return Value::object(literalString(((StringNode*)node)->symbol)); // allocated once, see literalString
             case NT_LET:
                 return evalLet((LetNode*)node, env);
             case NT_RETURN:
@@ -78,47 +63,65 @@ namespace corny {
                 return evalFunctionLiteral((FunctionNode*)node, env);
             case NT_IF:
                 return evalIfExpression((IfNode*)node, env);
+            case NT_WHILE:
+                return evalWhile((WhileNode*)node, env);
+            case NT_FOR:
+                return evalFor((ForNode*)node, env);
             default:
-                return new ErrorObj("Unknown Node type.");
+                return newError("Unknown Node type.");
         }
     }
     // evalProgram
-    Object* Evaluator::evalProgram(ProgramNode *programNode, Environment *env) {
-        Object* resultObj = evalStatements(programNode->statements, env);
+    Value Evaluator::evalProgram(ProgramNode *programNode, Environment *env) {
+        RootScope scope(gc);
+        scope.add(env); // the global environment
+        if (depth == 0) {
+            // the native stack grows down, calls may use all of it but STACK_RESERVE.
+            size_t size = nativeStackSize();
+            size_t budget = (size > 2 * STACK_RESERVE) ? size - STACK_RESERVE : size / 2;
+            stackLimit = (uintptr_t)__builtin_frame_address(0) - budget;
+        }
+        Value resultObj = stackless ? execute(programNode, env) : evalStatements(programNode->statements, env);
         // unwrap the return value
-        if (resultObj->type == OBJ_RETURN) {
-            return ((ReturnObj*)resultObj)->value;
+        if (resultObj.isReturn()) {
+            return returnValue;
+        }
+        // the error reached the top, this is the only place it becomes an object.
+        if (resultObj.isError()) {
+            return Value::object(gc.make<ErrorObj>(errorMessage));
         }
         return resultObj;
     }
     // evalBlock
-    Object* Evaluator::evalBlock(BlockNode *blockNode, Environment *env) {
+    Value Evaluator::evalBlock(BlockNode *blockNode, Environment *env) {
         return evalStatements(blockNode->statements, env);
     }
     // evalLet
-    Object* Evaluator::evalLet(LetNode *letNode, Environment *env) {
+    Value Evaluator::evalLet(LetNode *letNode, Environment *env) {
         // evaluate the value property
-        Object* valueObj = eval(letNode->value, env);
-        if (isError(valueObj)) return valueObj;
+        Value valueObj = eval(letNode->value, env);
+        if (isAbrupt(valueObj)) return valueObj;
         // register the symbol
-        env->set(letNode->ident->value.literal, valueObj);
+        gc.write(env, letNode->ident->slot, valueObj);
 
         return valueObj;
     }
     // evalReturn
-    Object* Evaluator::evalReturn(ReturnNode *returnNode, Environment *env) {
-        Object* valueObj = eval(returnNode->value, env);
-        if (isError(valueObj)) return valueObj;
+    Value Evaluator::evalReturn(ReturnNode *returnNode, Environment *env) {
+        Value valueObj = eval(returnNode->value, env);
+        if (isAbrupt(valueObj)) return valueObj;
 
-        return new ReturnObj(valueObj);
+        returnValue = valueObj;
+        return Value::signal(Value::TAG_RETURN);
     }
     // evalIfExpression
-    Object* Evaluator::evalIfExpression(IfNode *ifNode, Environment *env) {
-        Object* conditionObj = eval(ifNode->condition, env);
-        if (isError(conditionObj)) return conditionObj;
-        if (conditionObj->type != OBJ_BOOLEAN) return new ErrorObj("Invalid data type for if condition");
+    Value Evaluator::evalIfExpression(IfNode *ifNode, Environment *env) {
+        Value conditionObj = eval(ifNode->condition, env);
+        if (isAbrupt(conditionObj)) return conditionObj;
+        conditionObj = checkCondition(conditionObj, "if");
+        if (isAbrupt(conditionObj)) return conditionObj;
         // evaluate if or else based on condition value.
-        if (((BooleanObj*)conditionObj)->value == true) {
+        if (conditionObj.asBoolean() == true) {
             return eval(ifNode->consequence, env);
         } else {
             if (ifNode->alternative != nullptr) {
@@ -128,276 +131,796 @@ namespace corny {
             }
         }
     }
+    // checkCondition: the condition of an if or a while must be a boolean.
+    Value Evaluator::checkCondition(Value conditionObj, const char* statement) {
+        if (!conditionObj.isBoolean()) return newError(std::string("Invalid data type for ") + statement + " condition");
+        return conditionObj;
+    }
+    // evalWhile: every iteration runs in the same environment, a loop evaluates to null.
+    Value Evaluator::evalWhile(WhileNode *whileNode, Environment *env) {
+        while (true) {
+            Value conditionObj = eval(whileNode->condition, env);
+            if (isAbrupt(conditionObj)) return conditionObj;
+            conditionObj = checkCondition(conditionObj, "while");
+            if (isAbrupt(conditionObj)) return conditionObj;
+            if (conditionObj.asBoolean() == false) return NIL;
+            Value resultObj = evalStatements(whileNode->body->statements, env);
+            if (isAbrupt(resultObj)) return resultObj;
+        }
+    }
+    // checkIterable: a for loop only iterates over arrays.
+    Value Evaluator::checkIterable(Value iterableObj) {
+        if (!iterableObj.is(OBJ_ARRAY)) return newError("Invalid data type for loop iterable");
+        return iterableObj;
+    }
+    // evalFor: bind the loop variable to every element of an array in turn.
+    Value Evaluator::evalFor(ForNode *forNode, Environment *env) {
+        Value iterableObj = eval(forNode->iterable, env);
+        if (isAbrupt(iterableObj)) return iterableObj;
+        iterableObj = checkIterable(iterableObj);
+        if (isAbrupt(iterableObj)) return iterableObj;
+        RootScope scope(gc);
+        size_t iterable = scope.push(iterableObj); // the body may move the array
+        for (size_t index = 0; ; index++) {
+            ArrayObj* arrayObj = (ArrayObj*)scope.get(iterable).asObject();
+            if (index >= arrayObj->elements.size()) return NIL;
+            gc.write(env, forNode->ident->slot, arrayObj->elements[index]);
+            Value resultObj = evalStatements(forNode->body->statements, env);
+            if (isAbrupt(resultObj)) return resultObj;
+        }
+    }
     // evalUnaryExpression
-    Object* Evaluator::evalUnaryExpression(UnaryNode *unaryNode, Environment *env) {
-        Object* resultObj;
-        Object* rightObj = eval(unaryNode->left, env);
-        if (isError(rightObj)) return rightObj;
+    Value Evaluator::evalUnaryExpression(UnaryNode *unaryNode, Environment *env) {
+        Value rightObj = eval(unaryNode->left, env);
+        if (isAbrupt(rightObj)) return rightObj;
+        return evalUnaryOperator(unaryNode, rightObj);
+    }
+    // evalUnaryOperator: apply the operator of 'unaryNode' to its evaluated operand.
+    Value Evaluator::evalUnaryOperator(UnaryNode *unaryNode, Value rightObj) {
         // check the token operator
         switch (unaryNode->opToken.type) {
             case TT_MINUS:
-                if (rightObj->type != OBJ_NUMBER) return new ErrorObj("Invalid data type");
-                resultObj = new NumberObj(((NumberObj*)rightObj)->value * -1);
-                break;
+                if (!rightObj.isNumber()) return newError("Invalid data type");
+                return Value::number(rightObj.asNumber() * -1);
             case TT_NOT:
-                if (rightObj->type != OBJ_BOOLEAN) return new ErrorObj("Invalid data type");
-                resultObj = (((BooleanObj*)rightObj)->value == true) ? FALSE : TRUE;
-                break;
+                if (!rightObj.isBoolean()) return newError("Invalid data type");
+                return (rightObj.asBoolean() == true) ? FALSE : TRUE;
             default:
-                return new ErrorObj("Invalid operator: " + unaryNode->opToken.literal);
+                return newError("Invalid operator: " + std::string(unaryNode->opToken.literal));
         }
-        gc.add(resultObj);
-        return resultObj;
     }
     // evalBinaryExpression
-    Object* Evaluator::evalBinaryExpression(BinOpNode *binOpNode, Environment *env) {
+    Value Evaluator::evalBinaryExpression(BinOpNode *binOpNode, Environment *env) {
         if (binOpNode->opToken.type == TT_AND || binOpNode->opToken.type == TT_OR) {
             return evalLogicalExpression(binOpNode, env);
         }
         // we need to know the both operands types
-        Object* leftObj = eval(binOpNode->left, env);
-        if (isError(leftObj)) return leftObj;
-        Object* rightObj = eval(binOpNode->right, env);
-        if (isError(rightObj)) return rightObj;
+        Value leftObj = eval(binOpNode->left, env);
+        if (isAbrupt(leftObj)) return leftObj;
+        if (!leftObj.isObject()) { // nothing that could move, no root needed
+            Value rightObj = eval(binOpNode->right, env);
+            if (isAbrupt(rightObj)) return rightObj;
+            return evalBinaryOperator(binOpNode, leftObj, rightObj);
+        }
+        RootScope scope(gc);
+        size_t left = scope.push(leftObj);
+        Value rightObj = eval(binOpNode->right, env);
+        if (isAbrupt(rightObj)) return rightObj;
+        leftObj = scope.get(left); // the right operand may have moved it
+        return evalBinaryOperator(binOpNode, leftObj, rightObj);
+    }
+    // evalBinaryOperator: apply the (not logical) operator of 'binOpNode' to its evaluated operands.
+    // The node runs the operator it specialized to on its first run (see quickenBinary).
+    Value Evaluator::evalBinaryOperator(BinOpNode *binOpNode, Value leftObj, Value rightObj) {
+        BinaryOp op = binOpNode->op;
+        if (op == nullptr) op = quickenBinary(binOpNode, leftObj, rightObj);
+        return op(*this, binOpNode, leftObj, rightObj);
+    }
+    // evalGenericBinary: the operator of a node that is not specialized, it checks the operand types on every run.
+    Value Evaluator::evalGenericBinary(Evaluator& evaluator, BinOpNode *binOpNode, Value leftObj, Value rightObj) {
         // now based on their types we perform the correct operations
-        if (leftObj->type == OBJ_STRING && rightObj->type == OBJ_STRING) {
-            return evalBinaryString(leftObj, binOpNode->opToken.type, rightObj);
+        if (leftObj.isNumber() && rightObj.isNumber()) {
+            return evaluator.evalBinaryInteger(leftObj.asNumber(), binOpNode->opToken.type, rightObj.asNumber());
         }
-        if (leftObj->type == OBJ_NUMBER && rightObj->type == OBJ_NUMBER) {
-            return evalBinaryInteger(leftObj, binOpNode->opToken.type, rightObj);
+        if (leftObj.is(OBJ_STRING) && rightObj.is(OBJ_STRING)) {
+            return evaluator.evalBinaryString(leftObj, binOpNode->opToken.type, rightObj);
         }
-        if (leftObj->type == OBJ_BOOLEAN && rightObj->type == OBJ_NUMBER) {
-            return evalBinaryBoolean(leftObj, binOpNode->opToken.type, rightObj);
+        if (leftObj.isBoolean() && rightObj.isBoolean()) {
+            return evaluator.evalBinaryBoolean(leftObj, binOpNode->opToken.type, rightObj);
         }
+        return evaluator.newError("Invalid operand types for binary operation");
     }
     // evalLogicalExpression
-    Object* Evaluator::evalLogicalExpression(BinOpNode *binOpNode, Environment *env) {
+    Value Evaluator::evalLogicalExpression(BinOpNode *binOpNode, Environment *env) {
         // evaluate the left hand operator
-        Object* leftObj = eval(binOpNode->left, env);
-        if (isError(leftObj)) return leftObj;
-        if (leftObj->type != OBJ_BOOLEAN) return new ErrorObj("Invalid left hand type operand");
-        if (binOpNode->opToken.type == TT_AND) {
-            // if leftObj is false then there's nothing else to do.
-            if (((BooleanObj*)leftObj)->value == true) return FALSE;
-            // otherwise we need to evaluate the right hand operator
-            Object* rightObj = eval(binOpNode->right, env);
-            if (isError(rightObj)) return rightObj;
-            if (rightObj->type != OBJ_BOOLEAN) return new ErrorObj("Invalid right hand type operand");
-
-            return (((BooleanObj*)leftObj)->value == true) ? TRUE : FALSE;
-        }
-        else if (binOpNode->opToken.type == TT_OR){
-            // if leftObj is true then there's nothing else to do.
-            if (((BooleanObj*)leftObj)->value == true) return TRUE;
-            // otherwise we need to evaluate the right hand operator
-            Object* rightObj = eval(binOpNode->right, env);
-            if (isError(rightObj)) return rightObj;
-            if (rightObj->type != OBJ_BOOLEAN) return new ErrorObj("Invalid right hand type operand");
-
-            return (((BooleanObj*)leftObj)->value == true) ? TRUE : FALSE;
-        }
-        return new ErrorObj("Invalid operator for logical operation: " + binOpNode->opToken.literal);
+        Value leftObj = eval(binOpNode->left, env);
+        if (isAbrupt(leftObj)) return leftObj;
+        leftObj = checkLogicalOperand(leftObj, "left");
+        if (isAbrupt(leftObj)) return leftObj;
+        // 'and' stops on false, 'or' stops on true: nothing else to do.
+        if (shortCircuits(binOpNode, leftObj)) return leftObj;
+        // otherwise the right hand operator is the value
+        Value rightObj = eval(binOpNode->right, env);
+        if (isAbrupt(rightObj)) return rightObj;
+        return checkLogicalOperand(rightObj, "right");
+    }
+    // checkLogicalOperand: the operands of 'and' and 'or' must be booleans.
+    Value Evaluator::checkLogicalOperand(Value operandObj, const char* side) {
+        if (!operandObj.isBoolean()) return newError(std::string("Invalid ") + side + " hand type operand");
+        return operandObj;
+    }
+    // shortCircuits: whether the left operand alone decides a logical operator.
+    bool Evaluator::shortCircuits(BinOpNode *binOpNode, Value leftObj) {
+        return leftObj.asBoolean() == (binOpNode->opToken.type == TT_OR);
     }
     // evalBinaryString
-    Object* Evaluator::evalBinaryString(Object* leftObj, TokenType type, Object* rightObj) {
-        Object* resultObj;
+    Value Evaluator::evalBinaryString(Value leftObj, TokenType type, Value rightObj) {
         switch (type) {
             case TT_PLUS:
-                resultObj = new StringObj(((StringObj*)leftObj)->value + ((StringObj*)rightObj)->value);
-                break;
+                return Value::object(gc.make<StringObj>(((StringObj*)leftObj.asObject())->value + ((StringObj*)rightObj.asObject())->value));
             default:
-                return new ErrorObj("Invalid operator");
+                return newError("Invalid operator");
         }
-        gc.add(resultObj);
-        return resultObj;
     }
-    // evalBinaryInteger
-    Object* Evaluator::evalBinaryInteger(Object* leftObj, TokenType type, Object* rightObj) {
-        Object* resultObj;
+    // evalBinaryInteger: numbers live inside the Value, nothing is allocated.
+    Value Evaluator::evalBinaryInteger(double left, TokenType type, double right) {
         switch (type) {
             case TT_PLUS:
-                resultObj = new NumberObj(((NumberObj*)leftObj)->value + ((NumberObj*)rightObj)->value);
-                break;
+                return Value::number(left + right);
             case TT_MINUS:
-                resultObj = new NumberObj(((NumberObj*)leftObj)->value - ((NumberObj*)rightObj)->value);
-                break;
+                return Value::number(left - right);
             case TT_MUL:
-                resultObj = new NumberObj(((NumberObj*)leftObj)->value * ((NumberObj*)rightObj)->value);
-                break;
+                return Value::number(left * right);
             case TT_DIV:
-            {
-                double rightVal = ((NumberObj*)rightObj)->value;
-                if (rightVal <= 0) return new ErrorObj("Division by zero.");
-                resultObj = new NumberObj(((NumberObj*)leftObj)->value / rightVal);
-                break;
-            }
+                if (right == 0) return newError("Division by zero.");
+                return Value::number(left / right);
             case TT_LESS:
-                return (((NumberObj*)leftObj)->value < ((NumberObj*)rightObj)->value) ? TRUE : FALSE;
+                return (left < right) ? TRUE : FALSE;
             case TT_GREATER:
-                return (((NumberObj*)leftObj)->value > ((NumberObj*)rightObj)->value) ? TRUE : FALSE;
+                return (left > right) ? TRUE : FALSE;
             case TT_LESS_EQ:
-                return (((NumberObj*)leftObj)->value <= ((NumberObj*)rightObj)->value) ? TRUE : FALSE;
+                return (left <= right) ? TRUE : FALSE;
             case TT_GREATER_EQ:
-                return (((NumberObj*)leftObj)->value >= ((NumberObj*)rightObj)->value) ? TRUE : FALSE;
+                return (left >= right) ? TRUE : FALSE;
             case TT_EQUAL:
-                return (((NumberObj*)leftObj)->value == ((NumberObj*)rightObj)->value) ? TRUE : FALSE;
+                return (left == right) ? TRUE : FALSE;
             case TT_NOT_EQ:
-                return (((NumberObj*)leftObj)->value != ((NumberObj*)rightObj)->value) ? TRUE : FALSE;
+                return (left != right) ? TRUE : FALSE;
             default:
-                return new ErrorObj("Invalid operator.");
+                return newError("Invalid operator.");
         }
-        gc.add(resultObj); // add in GC
-        return resultObj;
+    }
+    // quickenBinary: rewrite 'binOpNode' into the variant for the operand types of its first
+    // run. The variants only guard those types, a failed guard makes the node generic for good.
+    BinaryOp Evaluator::quickenBinary(BinOpNode *binOpNode, Value leftObj, Value rightObj) {
+        BinaryOp op = &Evaluator::evalGenericBinary;
+        if (leftObj.isNumber() && rightObj.isNumber()) {
+            switch (binOpNode->opToken.type) {
+                case TT_PLUS: op = &Evaluator::addNumbers; break;
+                case TT_MINUS: op = &Evaluator::subtractNumbers; break;
+                case TT_MUL: op = &Evaluator::multiplyNumbers; break;
+                case TT_LESS: op = &Evaluator::lessNumbers; break;
+                case TT_GREATER: op = &Evaluator::greaterNumbers; break;
+                case TT_EQUAL: op = &Evaluator::equalNumbers; break;
+                default: op = &Evaluator::evalNumbers; break;
+            }
+        } else if (leftObj.is(OBJ_STRING) && rightObj.is(OBJ_STRING) && binOpNode->opToken.type == TT_PLUS) {
+            op = &Evaluator::concatStrings;
+        }
+        binOpNode->op = op;
+        return op;
+    }
+    // despecialize: the guard of 'binOpNode' failed, it stays generic from now on.
+    Value Evaluator::despecialize(Evaluator& evaluator, BinOpNode *binOpNode, Value leftObj, Value rightObj) {
+        binOpNode->op = &Evaluator::evalGenericBinary;
+        return evalGenericBinary(evaluator, binOpNode, leftObj, rightObj);
+    }
+    // addNumbers
+    Value Evaluator::addNumbers(Evaluator& evaluator, BinOpNode *binOpNode, Value leftObj, Value rightObj) {
+        if (!leftObj.isNumber() || !rightObj.isNumber()) return despecialize(evaluator, binOpNode, leftObj, rightObj);
+        return Value::number(leftObj.asNumber() + rightObj.asNumber());
+    }
+    // subtractNumbers
+    Value Evaluator::subtractNumbers(Evaluator& evaluator, BinOpNode *binOpNode, Value leftObj, Value rightObj) {
+        if (!leftObj.isNumber() || !rightObj.isNumber()) return despecialize(evaluator, binOpNode, leftObj, rightObj);
+        return Value::number(leftObj.asNumber() - rightObj.asNumber());
+    }
+    // multiplyNumbers
+    Value Evaluator::multiplyNumbers(Evaluator& evaluator, BinOpNode *binOpNode, Value leftObj, Value rightObj) {
+        if (!leftObj.isNumber() || !rightObj.isNumber()) return despecialize(evaluator, binOpNode, leftObj, rightObj);
+        return Value::number(leftObj.asNumber() * rightObj.asNumber());
+    }
+    // lessNumbers
+    Value Evaluator::lessNumbers(Evaluator& evaluator, BinOpNode *binOpNode, Value leftObj, Value rightObj) {
+        if (!leftObj.isNumber() || !rightObj.isNumber()) return despecialize(evaluator, binOpNode, leftObj, rightObj);
+        return (leftObj.asNumber() < rightObj.asNumber()) ? evaluator.TRUE : evaluator.FALSE;
+    }
+    // greaterNumbers
+    Value Evaluator::greaterNumbers(Evaluator& evaluator, BinOpNode *binOpNode, Value leftObj, Value rightObj) {
+        if (!leftObj.isNumber() || !rightObj.isNumber()) return despecialize(evaluator, binOpNode, leftObj, rightObj);
+        return (leftObj.asNumber() > rightObj.asNumber()) ? evaluator.TRUE : evaluator.FALSE;
+    }
+    // equalNumbers
+    Value Evaluator::equalNumbers(Evaluator& evaluator, BinOpNode *binOpNode, Value leftObj, Value rightObj) {
+        if (!leftObj.isNumber() || !rightObj.isNumber()) return despecialize(evaluator, binOpNode, leftObj, rightObj);
+        return (leftObj.asNumber() == rightObj.asNumber()) ? evaluator.TRUE : evaluator.FALSE;
+    }
+    // evalNumbers: the other number operators, they are rare enough to share one variant.
+    Value Evaluator::evalNumbers(Evaluator& evaluator, BinOpNode *binOpNode, Value leftObj, Value rightObj) {
+        if (!leftObj.isNumber() || !rightObj.isNumber()) return despecialize(evaluator, binOpNode, leftObj, rightObj);
+        return evaluator.evalBinaryInteger(leftObj.asNumber(), binOpNode->opToken.type, rightObj.asNumber());
+    }
+    // concatStrings
+    Value Evaluator::concatStrings(Evaluator& evaluator, BinOpNode *binOpNode, Value leftObj, Value rightObj) {
+        if (!leftObj.is(OBJ_STRING) || !rightObj.is(OBJ_STRING)) return despecialize(evaluator, binOpNode, leftObj, rightObj);
+        return evaluator.evalBinaryString(leftObj, TT_PLUS, rightObj);
     }
     // evalBinaryBoolean
-    Object* Evaluator::evalBinaryBoolean(Object* leftObj, TokenType type, Object* rightObj) {
+    Value Evaluator::evalBinaryBoolean(Value leftObj, TokenType type, Value rightObj) {
         // this is the trick: transform boolean to int and call binary integer operations.
-        NumberObj *leftNumber = new NumberObj((((BooleanObj*)leftObj)->value == true) ? 1 : 0);
-        NumberObj *rightNumber = new NumberObj((((BooleanObj*)rightObj)->value == true) ? 1 : 0);
-        return evalBinaryInteger(leftNumber, type, rightNumber);
+        return evalBinaryInteger(leftObj.asBoolean() ? 1 : 0, type, rightObj.asBoolean() ? 1 : 0);
     }
     // evalIdentifier
-    Object* Evaluator::evalIdentifier(IdentNode *identNode, Environment *env) {
-        std::string identifier = identNode->value.literal;
-        Object *valueObj = env->get(identifier);
-        if (valueObj == nullptr) {
-            return new ErrorObj("variable not defined: " + identifier);
+    Value Evaluator::evalIdentifier(IdentNode *identNode, Environment *env) {
+        const Symbol* identifier = identNode->value.symbol;
+        Value valueObj = (identNode->depth >= 0) ? env->get(identNode->depth, identNode->slot, identifier) : env->get(identifier);
+        if (valueObj.isEmpty()) {
+            return newError("variable not defined: " + identifier->name);
         }
         return valueObj;
     }
     // evalCallExpression
-    Object* Evaluator::evalCallExpr(CallExprNode *callExprNode, Environment *env) {
+    Value Evaluator::evalCallExpr(CallExprNode *callExprNode, Environment *env) {
         // this node can contain function call, array call or hash table call.
         // 1. get the object of the callee
-        Object* calleeObj = eval(callExprNode->callee, env);
-        if (isError(calleeObj)) return calleeObj;
+        Value calleeObj = eval(callExprNode->callee, env);
+        if (isAbrupt(calleeObj)) return calleeObj;
+        // the callee and the arguments stay on the argument stack until the call returns.
+        size_t base = arguments.size();
+        arguments.emplace_back(calleeObj);
         // 2. evaluate the arguments
-        std::vector<Object*> arguments;
-        if (callExprNode->arguments.size() > 0) {
-            Object* resultObj;
-            for (auto argument : callExprNode->arguments) {
-                resultObj = eval(argument, env);
-                if (isError(resultObj)) return resultObj;
-                arguments.emplace_back(resultObj);
+        Value resultObj;
+        for (auto argument : callExprNode->arguments) {
+            resultObj = eval(argument, env);
+            if (isAbrupt(resultObj)) {
+                arguments.resize(base);
+                return resultObj;
             }
+            arguments.emplace_back(resultObj);
         }
+        calleeObj = arguments[base];
+        const Value* args = arguments.data() + base + 1;
+        int argc = arguments.size() - base - 1;
         // 3. check the callee type
-        ObjType type = calleeObj->type;
-        switch (type) {
+        switch (calleeObj.type()) {
             case OBJ_FUNCTION:
-                return evalFunction((FunctionObj*)calleeObj, arguments);
+                if (callExprNode->tail) {
+                    // the callee and the arguments stay on the stack, the running evalFunction
+                    // calls it in place of the current function.
+                    tailCall = base;
+                    return Value::signal(Value::TAG_TAIL_CALL);
+                }
+                resultObj = evalFunction((FunctionObj*)calleeObj.asObject(), args, argc);
+                break;
+            default:
+                resultObj = evalAccess(callExprNode, calleeObj, args, argc);
+        }
+        arguments.resize(base);
+        return resultObj;
+    }
+    // evalAccess: a call whose callee is not a function, array, hash and string subscripts.
+    Value Evaluator::evalAccess(CallExprNode *callExprNode, Value calleeObj, const Value* args, int argc) {
+        switch (calleeObj.type()) {
             case OBJ_ARRAY:
-                return evalArrayAccess((ArrayObj*)calleeObj, arguments);
+                return evalArrayAccess((ArrayObj*)calleeObj.asObject(), args, argc);
             case OBJ_HASH:
-                return evalHashAccess((HashObj*)calleeObj, arguments);
+                return evalHashAccess((HashObj*)calleeObj.asObject(), args, argc, callExprNode->cache);
             case OBJ_STRING:
-                return evalStringAccess((StringObj*)calleeObj, arguments);
+                return evalStringAccess((StringObj*)calleeObj.asObject(), args, argc);
             default:
-                return new ErrorObj("Invalid callable object.");
+                return newError("Invalid callable object.");
         }
-
     }
     // evalFunctionLiteral
-    Object* Evaluator::evalFunctionLiteral(FunctionNode *functionNode, Environment *env) {
-        FunctionObj *functionObj = new FunctionObj();
+    Value Evaluator::evalFunctionLiteral(FunctionNode *functionNode, Environment *env) {
+        FunctionObj *functionObj = gc.make<FunctionObj>();
         functionObj->env = env;
+        env->captured = true; // the environment outlives its call now
         functionObj->parameters = functionNode->parameters;
         functionObj->body = functionNode->body;
-        gc.add(functionObj); // add in garbage collector
-        return functionObj;
+        functionObj->scope = &functionNode->scope;
+        functionObj->program = functionNode->program;
+        functionObj->program->retain(); // keep the AST alive while the function is
+        return Value::object(functionObj);
     }
     // evalArrayLiteral
-    Object* Evaluator::evalArrayLiteral(ArrayNode *arrayNode, Environment *env) {
-        ArrayObj *arrayObj = new ArrayObj();
-        // evaluate the elements of the array
-        if (arrayNode->elements.size() > 0) {
-            Object* resultObj;
-            for (auto element : arrayNode->elements) {
-                resultObj = eval(element, env);
-                if (isError(resultObj)) return resultObj;
-                // push the element into the array.
-                arrayObj->elements.emplace_back(resultObj);
+    Value Evaluator::evalArrayLiteral(ArrayNode *arrayNode, Environment *env) {
+        // the elements wait on the argument stack, which is rooted.
+        size_t base = arguments.size();
+        for (auto element : arrayNode->elements) {
+            Value resultObj = eval(element, env);
+            if (isAbrupt(resultObj)) {
+                arguments.resize(base);
+                return resultObj;
             }
+            arguments.emplace_back(resultObj);
         }
-        gc.add(arrayObj);
-        return arrayObj;
+        return makeArray(base);
+    }
+    // makeArray: the array of the values above 'base' on the argument stack, which it pops.
+    // The array is only allocated once it is complete, it is never written again.
+    Value Evaluator::makeArray(size_t base) {
+        // allocate first, the elements are copied once they can not move anymore.
+        ArrayObj* arrayObj = gc.make<ArrayObj>();
+        arrayObj->elements.assign(arguments.begin() + base, arguments.end());
+        arguments.resize(base);
+        return Value::object(arrayObj);
     }
     // evalHashLiteral
-    Object* Evaluator::evalHashLiteral(HashNode *hashNode, Environment *env) {
-        HashObj* hashObj = new HashObj();
-        int index = -1;
-        Object* keyObj, *valueObj;
-        // loop through keys and their values
-        for (auto keyNode : hashNode->keys) {
-            index += 1;
-            keyObj = eval(keyNode, env);
-            if (isError(keyObj)) return keyObj;
-            // validate the OBJ_STRING data type
-            if (keyObj->type != OBJ_STRING) return new ErrorObj("Invalid data type for key");
-            // evaluate the value
-            valueObj = eval(hashNode->values.at(index), env);
-            if (isError(valueObj)) return valueObj;
-            // save the key-value in data type
-            hashObj->elements[((StringObj*)keyObj)->value] = valueObj;
-        }
-        gc.add(hashObj);
-        return hashObj;
+    Value Evaluator::evalHashLiteral(HashNode *hashNode, Environment *env) {
+        // keys and values wait on the argument stack in turn, every key is checked right away.
+        size_t base = arguments.size();
+        for (size_t index = 0; index < hashNode->keys.size(); index++) {
+            Value keyObj = eval(hashNode->keys[index], env);
+            if (!isAbrupt(keyObj)) keyObj = checkKey(keyObj);
+            if (isAbrupt(keyObj)) {
+                arguments.resize(base);
+                return keyObj;
+            }
+            arguments.emplace_back(keyObj);
+            Value valueObj = eval(hashNode->values[index], env);
+            if (isAbrupt(valueObj)) {
+                arguments.resize(base);
+                return valueObj;
+            }
+            arguments.emplace_back(valueObj);
+        }
+        return makeHash(base);
+    }
+    // checkKey: the keys of a hash literal must be strings.
+    Value Evaluator::checkKey(Value keyObj) {
+        if (!keyObj.is(OBJ_STRING)) return newError("Invalid data type for key");
+        return keyObj;
+    }
+    // makeHash: the hash of the key and value pairs above 'base' on the argument stack, which
+    // it pops.
+    Value Evaluator::makeHash(size_t base) {
+        // allocate first: the pairs are only safe to read once no collection can move them.
+        size_t count = (arguments.size() - base) / 2;
+        HashObj* hashObj = gc.make<HashObj>();
+        hashObj->elements.reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            StringObj* key = (StringObj*)arguments[base + i * 2].asObject();
+            hashObj->elements.set(key->value, key->hashCode(), key->symbol, arguments[base + i * 2 + 1]);
+        }
+        arguments.resize(base);
+        return Value::object(hashObj);
     }
     // evalFunction
-    Object* Evaluator::evalFunction(FunctionObj *functionObj, std::vector<Object *> arguments) {
-        // 1. create new environment for the function
-        Environment* newEnv = new Environment();
-        newEnv->outer = functionObj->env; // enclose environment
+    // A tail call returns to this loop, which runs the callee in place of the function:
+    // the native stack does not grow and the released frame is taken again from the pool.
+    Value Evaluator::evalFunction(FunctionObj *functionObj, const Value* args, int argc) {
+        size_t top = arguments.size(); // the argument stack as the caller left it
+        while (true) {
+            // 1. create the environment of the call, with the arguments
+            Environment* newEnv = enterFunction(functionObj, args, argc);
+            if (newEnv == nullptr) return Value::signal(Value::TAG_ERROR);
+            RootScope scope(gc);
+            scope.add(newEnv);
+            if (arguments.size() > top) {
+                // drop the arguments of a previous tail call, its callee stays rooted while
+                // its body runs (the program of the body is only retained by the FunctionObj).
+                Value calleeObj = arguments[tailCall];
+                arguments.resize(top);
+                arguments.emplace_back(calleeObj);
+            }
+            // 2. execute the function with new environment
+            Value resultObj = eval(functionObj->body, newEnv);
+            gc.releaseFrame(newEnv); // back to the pool unless a closure captured it
+            depth -= 1;
+            if (resultObj.isError()) return resultObj;
+            // 3. check for return
+            if (resultObj.isReturn()) return returnValue;
+            if (resultObj.isSignal()) { // a tail call
+                functionObj = (FunctionObj*)arguments[tailCall].asObject();
+                args = arguments.data() + tailCall + 1;
+                argc = arguments.size() - tailCall - 1;
+                continue;
+            }
 
-        // 2. check for function arity.
-        int numArgs = arguments.size();
+            return resultObj;
+        }
+    }
+    // enterFunction: check the arity and the depth, then bind the arguments in a new
+    // environment (enclosed by the one of the function). nullptr after signalling an error.
+    Environment* Evaluator::enterFunction(FunctionObj *functionObj, const Value* args, int argc) {
         int numParams = functionObj->parameters.size();
-        if (numArgs != numParams) return new ErrorObj("Unexpected arguments, got: " + std::to_string(numArgs) + " want: " + std::to_string(numParams));
-
-        // 3. fill the new environment with arguments
+        if (argc != numParams) {
+            newError("Unexpected arguments, got: " + std::to_string(argc) + " want: " + std::to_string(numParams));
+            return nullptr;
+        }
+        if (depth >= maxDepth) {
+            newError("Stack overflow: more than " + std::to_string(maxDepth) + " nested calls");
+            return nullptr;
+        }
+        // maxDepth counts calls, the native stack may run out first when every call nests
+        // deep expressions. The stackless mode keeps its calls off the native stack.
+        if (!stackless && (uintptr_t)__builtin_frame_address(0) < stackLimit) {
+            newError("Stack overflow: the native stack is full after " + std::to_string(depth) + " nested calls");
+            return nullptr;
+        }
+        Environment* newEnv = gc.newEnvironment(functionObj->scope, functionObj->env);
         for (int i = 0; i < numParams; i++) {
-            newEnv->set(functionObj->parameters.at(i)->value.literal, arguments.at(i));
+            gc.write(newEnv, functionObj->parameters.at(i)->slot, args[i]);
         }
-        // 4. execute the function with new environment
-        Object *resultObj = eval(functionObj->body, newEnv);
-        if (isError(resultObj)) return resultObj;
-        // 5. check for return
-        if (resultObj->type == OBJ_RETURN) return ((ReturnObj*)resultObj)->value;
-
-        return resultObj;
+        depth += 1;
+        return newEnv;
+    }
+    // nativeStackSize: the stack size limit of the process (8 MB when it is unlimited).
+    size_t Evaluator::nativeStackSize() {
+        struct rlimit limit;
+        if (getrlimit(RLIMIT_STACK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) return limit.rlim_cur;
+        return 8 * 1024 * 1024;
     }
     // evalArrayAccess
-    Object* Evaluator::evalArrayAccess(ArrayObj *arrayObj, std::vector<Object *> arguments) {
-        Object* indexObj = arguments.at(0);
-        if (indexObj->type != OBJ_NUMBER) return new ErrorObj("Invalid subscript reference");
+    Value Evaluator::evalArrayAccess(ArrayObj *arrayObj, const Value* args, int argc) {
+        Value indexObj = (argc > 0) ? args[0] : NIL;
+        if (!indexObj.isNumber()) return newError("Invalid subscript reference");
         // check for out of bounds
-        int index = ((NumberObj*)indexObj)->value;
+        int index = indexObj.asNumber();
         if (index < 0 || index >= arrayObj->elements.size()) {
-            return new ErrorObj("Index out of bounds");
+            return newError("Index out of bounds");
         }
 
         return arrayObj->elements[index];
     }
     // evalHashAccess
-    Object* Evaluator::evalHashAccess(HashObj *hashObj, std::vector<Object *> arguments) {
-        Object* indexObj = arguments.at(0);
-        if (indexObj->type != OBJ_STRING) return new ErrorObj("Invalid subscript reference");
-        std::string key = ((StringObj*)indexObj)->value;
-        if (hashObj->elements.find(key) != hashObj->elements.end()) {
-            return hashObj->elements[key];
-        }
+    Value Evaluator::evalHashAccess(HashObj *hashObj, const Value* args, int argc, InlineCache& cache) {
+        Value indexObj = (argc > 0) ? args[0] : NIL;
+        if (!indexObj.is(OBJ_STRING)) return newError("Invalid subscript reference");
+        StringObj* key = (StringObj*)indexObj.asObject();
+        Value* value = cache.find(hashObj->elements, key->value, key->hashCode(), key->symbol);
+        if (value != nullptr) return *value;
         return NIL;
     }
     // stringAccess
-    Object* Evaluator::evalStringAccess(StringObj *stringObj, std::vector<Object *> arguments) {
-        Object* indexObj = arguments.at(0);
-        if (indexObj->type != OBJ_NUMBER) return new ErrorObj("Invalid subscript reference");
-        int index = ((NumberObj*)indexObj)->value;
+    Value Evaluator::evalStringAccess(StringObj *stringObj, const Value* args, int argc) {
+        Value indexObj = (argc > 0) ? args[0] : NIL;
+        if (!indexObj.isNumber()) return newError("Invalid subscript reference");
+        int index = indexObj.asNumber();
         // check for out of bounds
         if (index < 0 || index > stringObj->value.length()) {
-            return new ErrorObj("Index out of bounds");
+            return newError("Index out of bounds");
         }
-
-        return new StringObj(std::string(1, stringObj->value[index]));
+        return Value::object(gc.make<StringObj>(std::string(1, stringObj->value[index])));
+    }
+    // execute: the stackless mode. Instead of recursing, every node being evaluated is a Task
+    // and every intermediate value sits on the argument stack, so CornyLang calls use no
+    // native stack and the environments of the calls in progress are all in gc.frames.
+    // A task leaves exactly one value on the stack when it is done.
+    Value Evaluator::execute(Node *node, Environment *env) {
+        RootScope scope(gc); // the environments of the calls are pushed on gc.frames
+        size_t bottom = tasks.size();
+        size_t base = arguments.size();
+        size_t entryDepth = depth;
+        auto start = [&](Node* node, Environment* env) {
+            tasks.emplace_back(Task{node, env, arguments.size()});
+        };
+        start(node, env);
+        while (tasks.size() > bottom) {
+            // 'task' is only valid until the next start.
+            Task& task = tasks.back();
+            Value errorObj = NIL;
+            switch (task.node->type) {
+                case NT_PROGRAM:
+                case NT_BLOCK:
+                {
+                    std::vector<Node*>& statements = (task.node->type == NT_PROGRAM) ? ((ProgramNode*)task.node)->statements : ((BlockNode*)task.node)->statements;
+                    if ((size_t)task.state < statements.size()) {
+                        if (task.state > 0) arguments.pop_back(); // only the last value is kept
+                        Node* statement = statements[task.state++];
+                        start(statement, task.env);
+                        break;
+                    }
+                    if (statements.empty()) arguments.emplace_back(NIL); // an empty block evaluates to null
+                    tasks.pop_back();
+                    break;
+                }
+                case NT_LET:
+                {
+                    LetNode* letNode = (LetNode*)task.node;
+                    if (task.state == 0) {
+                        task.state = 1;
+                        start(letNode->value, task.env);
+                        break;
+                    }
+                    gc.write(task.env, letNode->ident->slot, arguments.back());
+                    tasks.pop_back();
+                    break;
+                }
+                case NT_RETURN:
+                {
+                    if (task.state == 0) {
+                        task.state = 1;
+                        start(((ReturnNode*)task.node)->value, task.env);
+                        break;
+                    }
+                    returnValue = arguments.back();
+                    size_t frame = runningCall(bottom);
+                    if (frame == SIZE_MAX) {
+                        // a 'return' in the program itself
+                        tasks.resize(bottom);
+                        arguments.resize(base);
+                        return Value::signal(Value::TAG_RETURN);
+                    }
+                    // unwind to the call, it finishes with the returned value
+                    tasks.resize(frame + 1);
+                    arguments.emplace_back(returnValue);
+                    break;
+                }
+                case NT_UNARY:
+                {
+                    UnaryNode* unaryNode = (UnaryNode*)task.node;
+                    if (task.state == 0) {
+                        task.state = 1;
+                        start(unaryNode->left, task.env);
+                        break;
+                    }
+                    Value resultObj = evalUnaryOperator(unaryNode, arguments.back());
+                    if (resultObj.isError()) {
+                        errorObj = resultObj;
+                        break;
+                    }
+                    arguments.back() = resultObj;
+                    tasks.pop_back();
+                    break;
+                }
+                case NT_BINARY:
+                {
+                    BinOpNode* binOpNode = (BinOpNode*)task.node;
+                    TokenType type = binOpNode->opToken.type;
+                    if (task.state == 0) {
+                        task.state = 1;
+                        start(binOpNode->left, task.env);
+                        break;
+                    }
+                    if (type == TT_AND || type == TT_OR) {
+                        Value operandObj = checkLogicalOperand(arguments.back(), task.state == 1 ? "left" : "right");
+                        if (operandObj.isError()) {
+                            errorObj = operandObj;
+                            break;
+                        }
+                        if (task.state == 1 && !shortCircuits(binOpNode, operandObj)) {
+                            arguments.pop_back();
+                            task.state = 2;
+                            start(binOpNode->right, task.env);
+                            break;
+                        }
+                        tasks.pop_back();
+                        break;
+                    }
+                    if (task.state == 1) {
+                        task.state = 2;
+                        start(binOpNode->right, task.env);
+                        break;
+                    }
+                    Value rightObj = arguments.back();
+                    arguments.pop_back();
+                    Value resultObj = evalBinaryOperator(binOpNode, arguments.back(), rightObj);
+                    if (resultObj.isError()) {
+                        errorObj = resultObj;
+                        break;
+                    }
+                    arguments.back() = resultObj;
+                    tasks.pop_back();
+                    break;
+                }
+                case NT_IF:
+                {
+                    IfNode* ifNode = (IfNode*)task.node;
+                    if (task.state == 0) {
+                        task.state = 1;
+                        start(ifNode->condition, task.env);
+                        break;
+                    }
+                    if (task.state == 2) { // the branch left its value
+                        tasks.pop_back();
+                        break;
+                    }
+                    Value conditionObj = checkCondition(arguments.back(), "if");
+                    arguments.pop_back();
+                    if (conditionObj.isError()) {
+                        errorObj = conditionObj;
+                        break;
+                    }
+                    Node* branch = conditionObj.asBoolean() ? ifNode->consequence : ifNode->alternative;
+                    if (branch == nullptr) {
+                        arguments.emplace_back(NIL);
+                        tasks.pop_back();
+                        break;
+                    }
+                    task.state = 2;
+                    start(branch, task.env);
+                    break;
+                }
+                case NT_WHILE:
+                {
+                    WhileNode* whileNode = (WhileNode*)task.node;
+                    if (task.state == 1) {
+                        Value conditionObj = checkCondition(arguments.back(), "while");
+                        arguments.pop_back();
+                        if (conditionObj.isError()) {
+                            errorObj = conditionObj;
+                            break;
+                        }
+                        if (conditionObj.asBoolean() == false) {
+                            arguments.emplace_back(NIL);
+                            tasks.pop_back();
+                            break;
+                        }
+                        task.state = 2;
+                        start(whileNode->body, task.env);
+                        break;
+                    }
+                    if (task.state == 2) arguments.pop_back(); // the value of the body
+                    task.state = 1;
+                    start(whileNode->condition, task.env);
+                    break;
+                }
+                case NT_FOR:
+                {
+                    ForNode* forNode = (ForNode*)task.node;
+                    if (task.state == 0) {
+                        task.state = 1;
+                        start(forNode->iterable, task.env);
+                        break;
+                    }
+                    if (task.state == 1) {
+                        Value iterableObj = checkIterable(arguments.back());
+                        if (iterableObj.isError()) {
+                            errorObj = iterableObj;
+                            break;
+                        }
+                        task.state = 2;
+                    } else {
+                        arguments.pop_back(); // the value of the body
+                    }
+                    // the array stays on the stack, where the task started
+                    ArrayObj* arrayObj = (ArrayObj*)arguments[task.base].asObject();
+                    if (task.index >= arrayObj->elements.size()) {
+                        arguments.back() = NIL;
+                        tasks.pop_back();
+                        break;
+                    }
+                    gc.write(task.env, forNode->ident->slot, arrayObj->elements[task.index++]);
+                    start(forNode->body, task.env);
+                    break;
+                }
+                case NT_ARRAY:
+                {
+                    std::vector<Node*>& elements = ((ArrayNode*)task.node)->elements;
+                    if ((size_t)task.state < elements.size()) {
+                        Node* element = elements[task.state++];
+                        start(element, task.env);
+                        break;
+                    }
+                    arguments.emplace_back(makeArray(task.base));
+                    tasks.pop_back();
+                    break;
+                }
+                case NT_HASH:
+                {
+                    // keys and values are evaluated in turn, every key is checked right away.
+                    HashNode* hashNode = (HashNode*)task.node;
+                    size_t count = hashNode->keys.size();
+                    if (task.state % 2 == 1) {
+                        Value keyObj = checkKey(arguments.back());
+                        if (keyObj.isError()) {
+                            errorObj = keyObj;
+                            break;
+                        }
+                    }
+                    if ((size_t)task.state < count * 2) {
+                        Node* next = (task.state % 2 == 0) ? (Node*)hashNode->keys[task.state / 2] : hashNode->values[task.state / 2];
+                        task.state += 1;
+                        start(next, task.env);
+                        break;
+                    }
+                    arguments.emplace_back(makeHash(task.base));
+                    tasks.pop_back();
+                    break;
+                }
+                case NT_CALL:
+                {
+                    CallExprNode* callExprNode = (CallExprNode*)task.node;
+                    if (task.state == Task::CALL_RUNNING) {
+                        // the body is done, its value is the value of the call
+                        gc.releaseFrame(task.env);
+                        gc.frames.pop_back();
+                        depth -= 1;
+                        Value resultObj = arguments.back();
+                        arguments.resize(task.base);
+                        arguments.emplace_back(resultObj);
+                        tasks.pop_back();
+                        break;
+                    }
+                    // 1. the callee, then the arguments
+                    if (task.state >= 0 && (size_t)task.state <= callExprNode->arguments.size()) {
+                        Node* next = (task.state == 0) ? callExprNode->callee : callExprNode->arguments[task.state - 1];
+                        task.state += 1;
+                        start(next, task.env);
+                        break;
+                    }
+                    // 2. check the callee type
+                    Value calleeObj = arguments[task.base];
+                    const Value* args = arguments.data() + task.base + 1;
+                    int argc = arguments.size() - task.base - 1;
+                    if (!calleeObj.is(OBJ_FUNCTION)) {
+                        Value resultObj = evalAccess(callExprNode, calleeObj, args, argc);
+                        if (resultObj.isError()) {
+                            errorObj = resultObj;
+                            break;
+                        }
+                        arguments.resize(task.base);
+                        arguments.emplace_back(resultObj);
+                        tasks.pop_back();
+                        break;
+                    }
+                    // 3. a tail call takes over the frame of the enclosing call
+                    size_t frame = (callExprNode->tail && task.state != Task::CALL_READY) ? runningCall(bottom) : SIZE_MAX;
+                    if (frame != SIZE_MAX) {
+                        Task& caller = tasks[frame];
+                        std::copy(arguments.begin() + task.base, arguments.end(), arguments.begin() + caller.base);
+                        arguments.resize(caller.base + argc + 1);
+                        gc.releaseFrame(caller.env);
+                        gc.frames.pop_back();
+                        depth -= 1;
+                        caller.state = Task::CALL_READY;
+                        tasks.resize(frame + 1);
+                        break;
+                    }
+                    // 4. run the body in a new environment
+                    FunctionObj* functionObj = (FunctionObj*)calleeObj.asObject();
+                    Environment* newEnv = enterFunction(functionObj, args, argc);
+                    if (newEnv == nullptr) {
+                        errorObj = Value::signal(Value::TAG_ERROR);
+                        break;
+                    }
+                    gc.frames.emplace_back(newEnv);
+                    task.env = newEnv;
+                    task.state = Task::CALL_RUNNING;
+                    start(functionObj->body, newEnv);
+                    break;
+                }
+                default:
+                {
+                    // literals, identifiers and function literals do not evaluate other nodes.
+                    Value resultObj = eval(task.node, task.env);
+                    if (resultObj.isError()) {
+                        errorObj = resultObj;
+                        break;
+                    }
+                    arguments.emplace_back(resultObj);
+                    tasks.pop_back();
+                }
+            }
+            if (errorObj.isError()) {
+                // an error stops the program: drop every task and call in progress.
+                tasks.resize(bottom);
+                arguments.resize(base);
+                depth = entryDepth;
+                return errorObj;
+            }
+        }
+        Value resultObj = arguments.back();
+        arguments.resize(base);
+        return resultObj;
+    }
+    // runningCall: the innermost call whose body is being evaluated, SIZE_MAX if there is none.
+    size_t Evaluator::runningCall(size_t bottom) {
+        for (size_t i = tasks.size(); i > bottom; i--) {
+            if (tasks[i - 1].node->type == NT_CALL && tasks[i - 1].state == Task::CALL_RUNNING) return i - 1;
+        }
+        return SIZE_MAX;
     }
-}
\ No newline at end of file
+}
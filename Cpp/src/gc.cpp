@@ -0,0 +1,457 @@
+//
+// Created by irwin on 16/10/2026.
+//
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include "../header/gc.h"
+
+namespace corny {
+    // GarbageCollector
+    GarbageCollector::GarbageCollector() {
+        this->nursery = new char[NURSERY_SIZE];
+        this->top = nursery;
+        pools[OBJ_ERROR].init(sizeof(ErrorObj));
+        pools[OBJ_STRING].init(sizeof(StringObj));
+        pools[OBJ_ARRAY].init(sizeof(ArrayObj));
+        pools[OBJ_HASH].init(sizeof(HashObj));
+        pools[OBJ_FUNCTION].init(sizeof(FunctionObj));
+        pools[OBJ_ENVIRONMENT].init(sizeof(Environment));
+    }
+    // ~GarbageCollector
+    GarbageCollector::~GarbageCollector() {
+        if (markerRunning) marker.join();
+        resetNursery();
+        delete[] nursery;
+        for (int type = 0; type < TYPE_COUNT; type++) {
+            for (auto page : pools[type].pages) {
+                for (size_t word = 0; word < Page::WORDS; word++) {
+                    for (uint64_t bits = page->allocated[word]; bits != 0; bits &= bits - 1) {
+                        destroy((Object*)page->slot(word * 64 + __builtin_ctzll(bits)));
+                    }
+                }
+            }
+        }
+    }
+    // collect: a minor collection, followed by some work on the major collection cycle
+    // in progress, or by a new cycle when the old generation went over the heap target.
+    void GarbageCollector::collect() {
+        minorCollect();
+        if (markerRunning) {
+            // let the marker work, unless the heap grows too fast to wait for it.
+            if (!markerDone && oldBytes < nextMajor * 2) return;
+            finishMarker();
+        }
+        if (phase == GC_SWEEPING) {
+            // pages are swept when their pool runs out of free slots (or within the pause
+            // budget), the rest of them once the old generation needs a new cycle.
+            if (oldBytes < nextMajor) {
+                if (pauseBudget.count() > 0) step(std::chrono::steady_clock::now() + pauseBudget);
+                return;
+            }
+            step(std::chrono::steady_clock::time_point::max());
+        }
+        if (phase == GC_IDLE) {
+            if (oldBytes < nextMajor) return;
+            startCycle();
+            if (concurrent) {
+                startMarker();
+                return;
+            }
+        }
+        if (pauseBudget.count() == 0 || oldBytes >= nextMajor * 2) {
+            // stop the world, also when the program allocates faster than the cycle advances.
+            markAll();
+            return;
+        }
+        step(std::chrono::steady_clock::now() + pauseBudget);
+    }
+    // heapSize: bytes used by an old object, including the memory its members own.
+    size_t GarbageCollector::heapSize(Object* obj) {
+        size_t size = obj->byteSize();
+        switch (obj->type) {
+            case OBJ_STRING:
+                return size + ((StringObj*)obj)->value.capacity();
+            case OBJ_ARRAY:
+                return size + ((ArrayObj*)obj)->elements.capacity() * sizeof(Value);
+            case OBJ_HASH:
+                return size + ((HashObj*)obj)->elements.entries.capacity() * sizeof(HashTable::Entry) + ((HashObj*)obj)->elements.indices.size() * sizeof(int32_t);
+            case OBJ_ENVIRONMENT:
+                return size + sizeof(Value) * 4; // a few slots, the pool reuses them anyway
+            default:
+                return size;
+        }
+    }
+    // minorCollect: promote the live young objects, the roots are updated in place.
+    void GarbageCollector::minorCollect() {
+        for (auto& root : roots) {
+            evacuate(root);
+        }
+        for (auto stack : stacks) {
+            for (auto& value : *stack) {
+                evacuate(value);
+            }
+        }
+        {
+            auto lock = lockEnvironments();
+            for (auto env : remembered) {
+                for (auto& slot : env->slots) {
+                    evacuate(slot);
+                }
+                env->remembered = false;
+            }
+            remembered.clear();
+        }
+        while (!promoted.empty()) {
+            Object* obj = promoted.back();
+            promoted.pop_back();
+            evacuateChildren(obj);
+        }
+        resetNursery();
+    }
+    // evacuate: move a young object to the old generation (once) and update the reference.
+    void GarbageCollector::evacuate(Value& value) {
+        if (!value.isObject()) return;
+        Object* obj = value.asObject();
+        if (obj->space == SPACE_OLD) return;
+        if (obj->space == SPACE_NONE) {
+            evacuateChildren(obj); // not collected, but it may point into the nursery.
+            return;
+        }
+        Object*& forward = forwarding(obj);
+        if (forward == nullptr) {
+            Object* copy = obj->promote(allocateOld(obj->type));
+            copy->space = SPACE_OLD;
+            if (phase != GC_IDLE) blacken(copy); // the cycle in progress does not scan it
+            oldBytes += heapSize(copy);
+            forward = copy; // leave a forwarding pointer behind
+            promoted.emplace_back(copy);
+        }
+        value = Value::object(forward);
+    }
+    // evacuateChildren
+    void GarbageCollector::evacuateChildren(Object* obj) {
+        switch (obj->type) {
+            case OBJ_ARRAY:
+                for (auto& element : ((ArrayObj*)obj)->elements) {
+                    evacuate(element);
+                }
+                break;
+            case OBJ_HASH:
+                for (auto& entry : ((HashObj*)obj)->elements) {
+                    evacuate(entry.value);
+                }
+                break;
+            default:
+                break; // the environment of a function is reached through the remembered set.
+        }
+    }
+    // resetNursery: destroy every young object (dead or already promoted).
+    void GarbageCollector::resetNursery() {
+        char* cursor = nursery;
+        while (cursor < top) {
+            Object* obj = (Object*)(cursor + sizeof(Object*));
+            cursor += sizeof(Object*) + align(obj->byteSize());
+            obj->destroy();
+        }
+        top = nursery;
+    }
+    // majorCollect: run a whole major collection cycle (or what is left of it), the
+    // nursery must be empty.
+    void GarbageCollector::majorCollect() {
+        if (markerRunning) finishMarker();
+        if (phase == GC_SWEEPING) step(std::chrono::steady_clock::time_point::max());
+        if (phase == GC_IDLE) startCycle();
+        step(std::chrono::steady_clock::time_point::max());
+    }
+    // markAll: finish the marking of the cycle in one go, the pages are then swept lazily.
+    void GarbageCollector::markAll() {
+        if (markerRunning) finishMarker();
+        if (markThreads > 1) {
+            markParallel(gray); // the interpreter waits anyway, use every marking thread
+        }
+        markSome(std::chrono::steady_clock::time_point::max());
+        startSweep();
+    }
+    // startCycle: shade the roots, the rest of the snapshot is marked from the gray ones.
+    // The marks of the previous cycle are left in the other bitmap, which the sweep of
+    // every page cleared.
+    void GarbageCollector::startCycle() {
+        phase = GC_MARKING;
+        epoch ^= 1;
+        for (auto root : roots) {
+            mark(root);
+        }
+        for (auto stack : stacks) {
+            for (auto value : *stack) {
+                mark(value);
+            }
+        }
+        for (auto env : frames) {
+            mark(env);
+        }
+        for (auto env : framePool) {
+            mark(env);
+        }
+    }
+    // step: advance the cycle until it is done or the deadline passes. Returns true when done.
+    bool GarbageCollector::step(std::chrono::steady_clock::time_point deadline) {
+        if (phase == GC_MARKING) {
+            if (deadline == std::chrono::steady_clock::time_point::max()) {
+                markAll();
+            } else if (!markSome(deadline)) {
+                return false;
+            } else {
+                startSweep();
+            }
+        }
+        if (!sweepSome(deadline)) return false;
+        finishCycle();
+        return true;
+    }
+    // markSome: blacken gray objects, returns true when there are none left.
+    bool GarbageCollector::markSome(std::chrono::steady_clock::time_point deadline) {
+        size_t count = 0;
+        while (!gray.empty()) {
+            Object* obj = gray.back();
+            gray.pop_back();
+            scan(obj);
+            if (++count % MARK_CHUNK == 0 && std::chrono::steady_clock::now() >= deadline) return false;
+        }
+        return true;
+    }
+    // startSweep: no gray objects left, everything white is garbage. Every page in use
+    // waits to be swept.
+    void GarbageCollector::startSweep() {
+        phase = GC_SWEEPING;
+        for (int type = 0; type < TYPE_COUNT; type++) {
+            unswept[type] = pools[type].pages;
+        }
+    }
+    // sweepSome: sweep pages until the deadline, returns true when every page was swept.
+    bool GarbageCollector::sweepSome(std::chrono::steady_clock::time_point deadline) {
+        for (int type = 0; type < TYPE_COUNT; type++) {
+            while (!unswept[type].empty()) {
+                Page* page = unswept[type].back();
+                unswept[type].pop_back();
+                sweep(page);
+                if (std::chrono::steady_clock::now() >= deadline) return false;
+            }
+        }
+        return true;
+    }
+    // sweep: free the objects of a page that are allocated but not marked, then clear
+    // the bitmap of the previous cycle so the next one can mark in it.
+    void GarbageCollector::sweep(Page* page) {
+        uint64_t* marks = page->marks[epoch];
+        for (size_t word = 0; word < Page::WORDS; word++) {
+            for (uint64_t dead = page->allocated[word] & ~marks[word]; dead != 0; dead &= dead - 1) {
+                Object* obj = (Object*)page->slot(word * 64 + __builtin_ctzll(dead));
+                oldBytes -= heapSize(obj);
+                destroy(obj);
+            }
+        }
+        std::memset(page->marks[epoch ^ 1], 0, sizeof(page->marks[0]));
+    }
+    // finishCycle
+    void GarbageCollector::finishCycle() {
+        phase = GC_IDLE;
+        // a heap that is mostly live gets room to grow before the next major collection.
+        nextMajor = std::max(heapTarget, oldBytes * 2);
+    }
+    // startMarker: hand the gray roots to a background thread.
+    void GarbageCollector::startMarker() {
+        markerDone = false;
+        markerRunning = true;
+        marker = std::thread([this, work = std::move(gray)]() mutable {
+            markConcurrently(work);
+        });
+        gray.clear();
+    }
+    // finishMarker: the final pause, what the barrier shaded after the marker stopped is
+    // marked by this thread.
+    void GarbageCollector::finishMarker() {
+        marker.join();
+        markerRunning = false;
+        gray.insert(gray.end(), shaded.begin(), shaded.end());
+        shaded.clear();
+    }
+    // markConcurrently: the marker thread.
+    void GarbageCollector::markConcurrently(std::vector<Object*>& work) {
+        std::vector<Value> slots;
+        while (true) {
+            if (markThreads > 1) {
+                markParallel(work);
+            } else {
+                while (!work.empty()) {
+                    Object* obj = work.back();
+                    work.pop_back();
+                    trace(obj, work, slots);
+                }
+            }
+            std::lock_guard<std::mutex> lock(shadedLock);
+            if (shaded.empty()) {
+                markerDone = true;
+                return;
+            }
+            work.swap(shaded);
+        }
+    }
+    // trace: mark the children of an old object from a thread other than the interpreter's
+    // (or while it waits), the ones this thread marked first are pushed on 'work'. It only
+    // ever looks at old objects: a young one was allocated after the cycle started, and the
+    // nursery changes under its feet.
+    void GarbageCollector::trace(Object* obj, std::vector<Object*>& work, std::vector<Value>& slots) {
+        auto visit = [&](Value value) {
+            if (!value.isObject()) return;
+            Object* child = value.asObject();
+            if ((char*)child >= nursery && (char*)child < nursery + NURSERY_SIZE) return;
+            if (child->space != SPACE_OLD) return;
+            if (!Page::of(child)->testAndMarkAtomic(child, epoch)) work.emplace_back(child);
+        };
+        switch (obj->type) {
+            case OBJ_ARRAY:
+                for (auto element : ((ArrayObj*)obj)->elements) {
+                    visit(element);
+                }
+                break;
+            case OBJ_HASH:
+                for (auto& entry : ((HashObj*)obj)->elements) {
+                    visit(entry.value);
+                }
+                break;
+            case OBJ_FUNCTION:
+                if (((FunctionObj*)obj)->env != nullptr) visit(Value::object(((FunctionObj*)obj)->env));
+                break;
+            case OBJ_ENVIRONMENT:
+            {
+                Environment* env = (Environment*)obj;
+                Environment* outer;
+                {
+                    std::lock_guard<std::mutex> lock(envLock);
+                    slots.clear();
+                    for (auto& slot : env->slots) {
+                        slots.emplace_back(Value::fromBits(__atomic_load_n(&slot.bits, __ATOMIC_RELAXED)));
+                    }
+                    outer = env->outer;
+                }
+                for (auto value : slots) {
+                    visit(value);
+                }
+                if (outer != nullptr) visit(Value::object(outer));
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    // markParallel: mark everything reachable from 'work' with markThreads threads, the
+    // calling one included. Every thread works on a private stack and publishes its surplus
+    // in a locked list, where idle threads steal half of it.
+    void GarbageCollector::markParallel(std::vector<Object*>& work) {
+        struct Worker {
+            std::mutex lock;
+            std::vector<Object*> shared;
+        };
+        int count = markThreads;
+        std::unique_ptr<Worker[]> workers(new Worker[count]);
+        std::atomic<size_t> pending{work.size()}; // queued objects not traced yet
+        for (size_t i = 0; i < work.size(); i++) {
+            workers[i % count].shared.emplace_back(work[i]);
+        }
+        work.clear();
+
+        auto run = [&](int id) {
+            std::vector<Object*> local;
+            std::vector<Value> slots;
+            while (true) {
+                // refill from its own list first, then from the others.
+                for (int i = 0; i < count && local.empty(); i++) {
+                    Worker& victim = workers[(id + i) % count];
+                    std::lock_guard<std::mutex> lock(victim.lock);
+                    size_t take = (victim.shared.size() + 1) / 2;
+                    local.insert(local.end(), victim.shared.end() - take, victim.shared.end());
+                    victim.shared.resize(victim.shared.size() - take);
+                }
+                if (local.empty()) {
+                    if (pending.load() == 0) return;
+                    std::this_thread::yield();
+                    continue;
+                }
+                while (!local.empty()) {
+                    Object* obj = local.back();
+                    local.pop_back();
+                    size_t before = local.size();
+                    trace(obj, local, slots);
+                    pending.fetch_add(local.size() - before); // children first, so pending can't hit 0 early
+                    pending.fetch_sub(1);
+                    if (local.size() > STEAL_BATCH) {
+                        // share the oldest half, it tends to hold the larger subgraphs.
+                        Worker& self = workers[id];
+                        size_t give = local.size() / 2;
+                        std::lock_guard<std::mutex> lock(self.lock);
+                        self.shared.insert(self.shared.end(), local.begin(), local.begin() + give);
+                        local.erase(local.begin(), local.begin() + give);
+                    }
+                }
+            }
+        };
+        std::vector<std::thread> threads;
+        for (int id = 1; id < count; id++) {
+            threads.emplace_back(run, id);
+        }
+        run(0);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    // Mark an object: old objects turn gray, they are scanned later from the worklist.
+    void GarbageCollector::mark(Object* obj) {
+        if (obj->space == SPACE_OLD && markerRunning) {
+            // the barrier, while the marker thread runs.
+            if (Page::of(obj)->testAndMarkAtomic(obj, epoch)) return;
+            std::lock_guard<std::mutex> lock(shadedLock);
+            shaded.emplace_back(obj);
+        } else if (obj->space == SPACE_OLD) {
+            if (Page::of(obj)->testAndMark(obj, epoch)) return;
+            gray.emplace_back(obj);
+        } else if (obj->space == SPACE_NONE) {
+            // objects outside the GC are never swept, they are only traversed.
+            scan(obj);
+        }
+    }
+    // overload the mark method to allow Values: only heap objects need marking.
+    void GarbageCollector::mark(Value value) {
+        if (value.isObject()) mark(value.asObject());
+    }
+    // scan: mark the children of an object.
+    void GarbageCollector::scan(Object* obj) {
+        switch (obj->type) {
+            case OBJ_ARRAY:
+                for (auto element : ((ArrayObj*)obj)->elements) {
+                    mark(element);
+                }
+                break;
+            case OBJ_HASH:
+                for (auto& entry : ((HashObj*)obj)->elements) {
+                    mark(entry.value);
+                }
+                break;
+            case OBJ_FUNCTION:
+                // a function keeps its enclosing environment alive
+                if (((FunctionObj*)obj)->env != nullptr) mark(((FunctionObj*)obj)->env);
+                break;
+            case OBJ_ENVIRONMENT:
+            {
+                Environment* env = (Environment*)obj;
+                for (auto value : env->slots) {
+                    mark(value);
+                }
+                if (env->outer != nullptr) mark(env->outer);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
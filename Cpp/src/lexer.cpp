@@ -3,13 +3,14 @@
 //
 #include <iostream>
 #include "../header/lexer.h"
+#include "../header/symbol.h"
 
 namespace corny {
     // start
-    void Lexer::start(std::string input) {
+    void Lexer::start(std::string_view input) {
         this->input = input;
         this->pos = 0;
-        this->current_char = input[pos]; // move to the first character.
+        this->current_char = input.empty() ? NONE : input[pos]; // move to the first character.
     }
     // checkEOF
     void Lexer::checkEOF() {
@@ -37,12 +38,11 @@ namespace corny {
     // advance
     void Lexer::advance() {
         pos += 1;
-        if (pos >= input.length()) current_char = NONE;
-        current_char = input[pos];
+        current_char = (pos < input.length()) ? input[pos] : NONE;
     }
     // peek
     char Lexer::peek() {
-        int peekPos = pos + 1;
+        size_t peekPos = pos + 1;
         if (peekPos >= input.length()) return NONE;
         return input[peekPos];
     }
@@ -61,47 +61,51 @@ namespace corny {
         }
         //checkEOF();
     }
-    // getNumber
-    std::string Lexer::getNumber() {
-        std::string numStr;
+    // skipDigits
+    void Lexer::skipDigits() {
         while (current_char != NONE && isDigit(current_char)) {
-            numStr += current_char;
             advance();
         }
         //checkEOF();
-        return numStr;
+    }
+    // makeToken: the lexeme is the span of the input between 'start' and the current position.
+    Token Lexer::makeToken(TokenType type, size_t start) {
+        return Token(type, input.substr(start, pos - start));
     }
     // parseInteger
     Token Lexer::parseInteger() {
-        std::string lexeme = getNumber();
+        size_t start = pos;
+        skipDigits();
         if (current_char == '.' && isDigit(peek())) {
-            lexeme += '.';
             advance(); // skip the '.'
-            lexeme += getNumber();
+            skipDigits();
         }
-        return Token(TT_NUMBER, lexeme);
+        return makeToken(TT_NUMBER, start);
     }
     // parseString
     Token Lexer::parseString(char delimiter) {
         advance(); // skip the delimiter
-        std::string lexeme;
+        size_t start = pos;
         while (current_char != NONE && current_char != delimiter) {
-            lexeme += current_char;
             advance();
         }
         //checkEOF();
+        Token token = makeToken(TT_STRING, start);
+        token.symbol = intern(token.literal);
         advance(); // skip the closing delimiter
 
-        return Token(TT_STRING, lexeme);
+        return token;
     }
     // parseIdentifier
     Token Lexer::parseIdent() {
-        std::string lexeme;
+        size_t start = pos;
         while (current_char != NONE && isLetter(current_char)) {
-            lexeme += current_char;
             advance();
         }
-        return Token(corny::isKeyword(lexeme), lexeme);
+        Token token = makeToken(TT_IDENT, start);
+        token.symbol = intern(token.literal); // keywords are symbols too, see SymbolTable
+        token.type = token.symbol->keyword;
+        return token;
     }
     // nextToken
     Token Lexer::nextToken() {
@@ -117,102 +121,103 @@ namespace corny {
             if (isDigit(current_char)) return parseInteger();
             if (isAlpha(current_char)) return parseIdent();
             if (isString(current_char)) return parseString(current_char);
+            size_t start = pos;
             // Arithmetic operator
             if (current_char == '+') {
                 advance();
-                return Token(TT_PLUS, '+');
+                return makeToken(TT_PLUS, start);
             }
             if (current_char == '-') {
                 advance();
-                return Token(TT_MINUS, '-');
+                return makeToken(TT_MINUS, start);
             }
             if (current_char == '*') {
                 advance();
-                return Token(TT_MUL, '*');
+                return makeToken(TT_MUL, start);
             }
             if (current_char == '/') {
                 advance();
-                return Token(TT_DIV, '/');
+                return makeToken(TT_DIV, start);
             }
             if (current_char == '^') {
                 advance();
-                return Token(TT_POW, '^');
+                return makeToken(TT_POW, start);
             }
             // Relational operators
             if (current_char == '<') {
                 advance();
                 if (current_char == '=') {
                     advance();
-                    return Token(TT_LESS_EQ, "<=");
+                    return makeToken(TT_LESS_EQ, start);
                 }
-                return Token(TT_LESS, '<');
+                return makeToken(TT_LESS, start);
             }
             if (current_char == '>') {
                 advance();
                 if (current_char == '=') {
                     advance();
-                    return Token(TT_GREATER_EQ, ">=");
+                    return makeToken(TT_GREATER_EQ, start);
                 }
-                return Token(TT_GREATER, '>');
+                return makeToken(TT_GREATER, start);
             }
             if (current_char == '!') {
                 advance();
                 if (current_char == '=') {
                     advance();
-                    return Token(TT_NOT_EQ, "!=");
+                    return makeToken(TT_NOT_EQ, start);
                 }
-                return Token(TT_NOT, '!');
+                return makeToken(TT_NOT, start);
             }
             if (current_char == '=') {
                 advance();
                 if (current_char == '=') {
                     advance();
-                    return Token(TT_EQUAL, "==");
+                    return makeToken(TT_EQUAL, start);
                 }
-                return Token(TT_ASSIGN, '=');
+                return makeToken(TT_ASSIGN, start);
             }
             // Special characters
             if (current_char == ',') {
                 advance();
-                return Token(TT_COMMA, ',');
+                return makeToken(TT_COMMA, start);
             }
             if (current_char == ':') {
                 advance();
-                return Token(TT_COLON, ':');
+                return makeToken(TT_COLON, start);
             }
             if (current_char == ';') {
                 advance();
-                return Token(TT_SEMICOLON, ';');
+                return makeToken(TT_SEMICOLON, start);
             }
             if (current_char == '{') {
                 advance();
-                return Token(TT_LBRACE, '{');
+                return makeToken(TT_LBRACE, start);
             }
             if (current_char == '}') {
                 advance();
-                return Token(TT_RBRACE, '}');
+                return makeToken(TT_RBRACE, start);
             }
             if (current_char == '[') {
                 advance();
-                return Token(TT_LBRACKET, '[');
+                return makeToken(TT_LBRACKET, start);
             }
             if (current_char == ']') {
                 advance();
-                return Token(TT_RBRACKET, ']');
+                return makeToken(TT_RBRACKET, start);
             }
             if (current_char == '(') {
                 advance();
-                return Token(TT_LPAREN, '(');
+                return makeToken(TT_LPAREN, start);
             }
             if (current_char == ')') {
                 advance();
-                return Token(TT_RPAREN, ')');
+                return makeToken(TT_RPAREN, start);
             }
 
             std::cout << "unknown character: " << current_char << std::endl;
             std::exit(1);
         }
-        return Token(TT_EOF, "");
+        return Token(TT_EOF, std::string_view());
     }
 }
 
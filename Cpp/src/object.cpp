@@ -0,0 +1,74 @@
+//
+// Created by irwin on 16/10/2026.
+//
+#include "../header/object.h"
+#include "../header/environment.h"
+#include "../header/code.h"
+
+namespace corny {
+    // ~FunctionObj: the AST belongs to its program and the proto to its script, let them go
+    // once no function needs them.
+    FunctionObj::~FunctionObj() {
+        if (program != nullptr) program->unretain();
+        if (proto != nullptr) proto->unretain();
+    }
+    // Inspect
+    std::string Object::Inspect() {
+        switch (type) {
+            case OBJ_ERROR: return ((ErrorObj*)this)->Inspect();
+            case OBJ_FUNCTION: return ((FunctionObj*)this)->Inspect();
+            case OBJ_ARRAY: return ((ArrayObj*)this)->Inspect();
+            case OBJ_HASH: return ((HashObj*)this)->Inspect();
+            case OBJ_STRING: return ((StringObj*)this)->Inspect();
+            case OBJ_ENVIRONMENT: return ((Environment*)this)->Inspect();
+            default: return "unknown";
+        }
+    }
+    // byteSize
+    size_t Object::byteSize() {
+        switch (type) {
+            case OBJ_ERROR: return sizeof(ErrorObj);
+            case OBJ_FUNCTION: return sizeof(FunctionObj);
+            case OBJ_ARRAY: return sizeof(ArrayObj);
+            case OBJ_HASH: return sizeof(HashObj);
+            case OBJ_STRING: return sizeof(StringObj);
+            case OBJ_ENVIRONMENT: return sizeof(Environment);
+            default: return sizeof(Object);
+        }
+    }
+    // promote
+    Object* Object::promote(void *memory) {
+        switch (type) {
+            case OBJ_ERROR: return ((ErrorObj*)this)->promote(memory);
+            case OBJ_FUNCTION: return ((FunctionObj*)this)->promote(memory);
+            case OBJ_ARRAY: return ((ArrayObj*)this)->promote(memory);
+            case OBJ_HASH: return ((HashObj*)this)->promote(memory);
+            case OBJ_STRING: return ((StringObj*)this)->promote(memory);
+            default: return nullptr; // environments are never allocated in the nursery
+        }
+    }
+    // destroy
+    void Object::destroy() {
+        switch (type) {
+            case OBJ_ERROR: ((ErrorObj*)this)->~ErrorObj(); break;
+            case OBJ_FUNCTION: ((FunctionObj*)this)->~FunctionObj(); break;
+            case OBJ_ARRAY: ((ArrayObj*)this)->~ArrayObj(); break;
+            case OBJ_HASH: ((HashObj*)this)->~HashObj(); break;
+            case OBJ_STRING: ((StringObj*)this)->~StringObj(); break;
+            case OBJ_ENVIRONMENT: ((Environment*)this)->~Environment(); break;
+            default: break;
+        }
+    }
+    // free
+    void Object::free(Object *obj) {
+        switch (obj->type) {
+            case OBJ_ERROR: delete (ErrorObj*)obj; break;
+            case OBJ_FUNCTION: delete (FunctionObj*)obj; break;
+            case OBJ_ARRAY: delete (ArrayObj*)obj; break;
+            case OBJ_HASH: delete (HashObj*)obj; break;
+            case OBJ_STRING: delete (StringObj*)obj; break;
+            case OBJ_ENVIRONMENT: delete (Environment*)obj; break;
+            default: delete obj; break;
+        }
+    }
+}
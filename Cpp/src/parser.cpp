@@ -1,12 +1,14 @@
 //
 // Created by irwin on 12/05/2021.
 //
+#include <charconv>
 #include "../header/parser.h"
 
 namespace corny {
-    // start
-    void Parser::start(Lexer lexer) {
-        this->lexer = lexer;
+    // start: the parser takes ownership of the source until parseProgram hands it to the program.
+    void Parser::start(Source* source) {
+        this->source = source;
+        lexer.start(source->text());
         nextToken();
         nextToken();
     }
@@ -24,8 +26,10 @@ namespace corny {
         peekToken = lexer.nextToken();
     }
     // program ::= ( statement )*
-    Node* Parser::parseProgram() {
-        ProgramNode* program = new ProgramNode();
+    ProgramNode* Parser::parseProgram() {
+        program = new ProgramNode(); // every other node is allocated in its arena
+        program->source = source; // tokens keep views into the source text
+        source = nullptr;
 
         while (curToken.type != TT_EOF) {
             program->statements.emplace_back(parseStatement());
@@ -35,7 +39,7 @@ namespace corny {
     }
     // parseBlock ::= '{' (statement)* '}'
     Node* Parser::parseBlock() {
-        BlockNode* blockNode = new BlockNode();
+        BlockNode* blockNode = make<BlockNode>();
 
         advance(TT_LBRACE);
         while (curToken.type != TT_RBRACE) {
@@ -45,7 +49,7 @@ namespace corny {
 
         return blockNode;
     }
-    // parseStatement ::= parseLetStatement | parseReturnStatement | parseExpression
+    // parseStatement ::= parseLetStatement | parseReturnStatement | parseWhileStatement | parseForStatement | parseExpression
     Node* Parser::parseStatement() {
         Node* statement;
         if (curToken.type == TT_LET) {
@@ -54,6 +58,12 @@ namespace corny {
         else if (curToken.type == TT_RETURN) {
             statement = parseReturnStatement();
         }
+        else if (curToken.type == TT_WHILE) {
+            statement = parseWhileStatement();
+        }
+        else if (curToken.type == TT_FOR) {
+            statement = parseForStatement();
+        }
         else {
             statement = parseExpression();
         }
@@ -65,7 +75,7 @@ namespace corny {
     }
     // parseLetStatement ::= 'let' IDENT '=' parseExpression
     Node* Parser::parseLetStatement() {
-        LetNode* letNode = new LetNode();
+        LetNode* letNode = make<LetNode>();
 
         advance(TT_LET);
 
@@ -77,13 +87,39 @@ namespace corny {
     }
     // parseReturnStatement ::= 'return' parseExpression
     Node* Parser::parseReturnStatement() {
-        ReturnNode* returnNode = new ReturnNode();
+        ReturnNode* returnNode = make<ReturnNode>();
 
         advance(TT_RETURN);
         returnNode->value = parseExpression();
 
         return returnNode;
     }
+    // parseWhileStatement ::= 'while' '(' parseExpression ')' parseBlock
+    Node* Parser::parseWhileStatement() {
+        WhileNode* whileNode = make<WhileNode>();
+
+        advance(TT_WHILE);
+        advance(TT_LPAREN);
+        whileNode->condition = parseExpression();
+        advance(TT_RPAREN);
+        whileNode->body = (BlockNode*)parseBlock();
+
+        return whileNode;
+    }
+    // parseForStatement ::= 'for' '(' IDENT 'in' parseExpression ')' parseBlock
+    Node* Parser::parseForStatement() {
+        ForNode* forNode = make<ForNode>();
+
+        advance(TT_FOR);
+        advance(TT_LPAREN);
+        forNode->ident = (IdentNode*)parseIdentifier();
+        advance(TT_IN);
+        forNode->iterable = parseExpression();
+        advance(TT_RPAREN);
+        forNode->body = (BlockNode*)parseBlock();
+
+        return forNode;
+    }
     // parseExpression ::= parseAssignment
     Node* Parser::parseExpression() {
         return parseAssignment();
@@ -98,7 +134,7 @@ namespace corny {
         while (curToken.type == TT_OR) {
             Token token = curToken;
             advance(TT_OR);
-            node = new BinOpNode(node, token, parseLogicAnd());
+            node = make<BinOpNode>(node, token, parseLogicAnd());
         }
         return node;
     }
@@ -108,7 +144,7 @@ namespace corny {
         while (curToken.type == TT_AND) {
             Token token = curToken;
             advance(TT_AND);
-            node = new BinOpNode(node, token, parseEquality());
+            node = make<BinOpNode>(node, token, parseEquality());
         }
         return node;
     }
@@ -118,7 +154,7 @@ namespace corny {
         while (curToken.type == TT_EQUAL || curToken.type == TT_NOT_EQ) {
             Token token = curToken;
             advance(token.type);
-            node = new BinOpNode(node, token, parseComparison());
+            node = make<BinOpNode>(node, token, parseComparison());
         }
         return node;
     }
@@ -130,7 +166,7 @@ namespace corny {
         {
             Token token = curToken;
             advance(token.type);
-            node = new BinOpNode(node, token, parseTerm());
+            node = make<BinOpNode>(node, token, parseTerm());
         }
         return node;
     }
@@ -140,7 +176,7 @@ namespace corny {
         while (curToken.type == TT_PLUS || curToken.type == TT_MINUS) {
             Token token = curToken;
             advance(token.type);
-            node = new BinOpNode(node, token, parseFactor());
+            node = make<BinOpNode>(node, token, parseFactor());
         }
         return node;
     }
@@ -150,7 +186,7 @@ namespace corny {
         while (curToken.type == TT_MUL || curToken.type == TT_DIV) {
             Token token = curToken;
             advance(token.type);
-            node = new BinOpNode(node, token, parseUnary());
+            node = make<BinOpNode>(node, token, parseUnary());
         }
         return node;
     }
@@ -159,7 +195,7 @@ namespace corny {
         while (curToken.type == TT_MINUS || curToken.type == TT_NOT) {
             Token token = curToken;
             advance(token.type);
-            return new UnaryNode(token, parseUnary()); // call itself
+            return make<UnaryNode>(token, parseUnary()); // call itself
         }
         return parseCall();
     }
@@ -184,17 +220,22 @@ namespace corny {
         Token token = curToken;
         switch (token.type) {
             case TT_NUMBER:
+            {
+                // convert the digits in place, no temporary string.
+                double value = 0.0;
+                std::from_chars(token.literal.data(), token.literal.data() + token.literal.size(), value);
                 advance(TT_NUMBER);
-                return new NumberNode(std::stod(token.literal));
+                return make<NumberNode>(value);
+            }
             case TT_TRUE:
                 advance(TT_TRUE);
-                return new BooleanNode(true);
+                return make<BooleanNode>(true);
             case TT_FALSE:
                 advance(TT_FALSE);
-                return new BooleanNode(false);
+                return make<BooleanNode>(false);
             case TT_NULL:
                 advance(TT_NULL);
-                return new NullNode();
+                return make<NullNode>();
             case TT_IDENT:
                 return parseIdentifier();
             case TT_LPAREN: {
@@ -205,7 +246,7 @@ namespace corny {
             }
             case TT_STRING:
                 advance(TT_STRING);
-                return new StringNode(token.literal);
+                return make<StringNode>(token.literal, token.symbol);
             case TT_FUNCTION:
                 return parseFunctionLiteral();
             case TT_LBRACKET:
@@ -221,7 +262,7 @@ namespace corny {
     }
     // parseCallExpr ::= FUNCTIONCALL | ARRAYCALL | HASHCALL
     Node* Parser::parseCallExpr(Node *callee, Token token) {
-        CallExprNode *callExprNode = new CallExprNode();
+        CallExprNode *callExprNode = make<CallExprNode>();
         callExprNode->callee = callee;
 
         if (token.type == TT_LBRACKET) { // array or hash call
@@ -248,7 +289,7 @@ namespace corny {
     }
     // parseTernaryExpr
     Node* Parser::parseTernaryExpr(Node *condition) {
-        IfNode *ifNode = new IfNode();
+        IfNode *ifNode = make<IfNode>();
 
         ifNode->condition = parseExpression();
 
@@ -262,7 +303,8 @@ namespace corny {
     }
     // parseFunctionLiteral
     Node* Parser::parseFunctionLiteral() {
-        FunctionNode *functionNode = new FunctionNode();
+        FunctionNode *functionNode = make<FunctionNode>();
+        functionNode->program = program;
         advance(TT_FUNCTION);
         advance(TT_LPAREN);
         if (curToken.type != TT_RPAREN) {
@@ -279,7 +321,7 @@ namespace corny {
     }
     // parseArrayLiteral
     Node* Parser::parseArrayLiteral() {
-        ArrayNode* arrayNode = new ArrayNode();
+        ArrayNode* arrayNode = make<ArrayNode>();
         advance(TT_LBRACKET);
         if (curToken.type != TT_RBRACKET) {
             arrayNode->elements.emplace_back(parseExpression());
@@ -294,7 +336,7 @@ namespace corny {
     }
     // parseHashLiteral
     Node* Parser::parseHashLiteral() {
-        HashNode* hashNode = new HashNode();
+        HashNode* hashNode = make<HashNode>();
         advance(TT_LBRACE);
         if (curToken.type != TT_RBRACE) {
             // parse key-value pair expressions
@@ -315,7 +357,7 @@ namespace corny {
     }
     // parseIfExpression
     Node* Parser::parseIfExpr() {
-        IfNode* ifNode = new IfNode();
+        IfNode* ifNode = make<IfNode>();
 
         advance(TT_IF);
 
@@ -325,7 +367,7 @@ namespace corny {
 
         ifNode->consequence = parseBlock();
 
-        if (curToken.type = TT_ELSE) {
+        if (curToken.type == TT_ELSE) {
             advance(TT_ELSE);
             ifNode->alternative = parseBlock();
         }
@@ -334,7 +376,7 @@ namespace corny {
     }
     // parserIdentifier
     Node* Parser::parseIdentifier() {
-        IdentNode* identNode = new IdentNode();
+        IdentNode* identNode = make<IdentNode>();
         identNode->value = curToken;
 
         advance(TT_IDENT); // skip the IDENT token.
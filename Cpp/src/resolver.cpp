@@ -0,0 +1,223 @@
+//
+// Created by irwin on 16/10/2026.
+//
+#include "../header/resolver.h"
+
+namespace corny {
+    // resolve: a program is resolved in the global scope.
+    void Resolver::resolve(ProgramNode *programNode) {
+        scopes.clear();
+        scopes.emplace_back(&globals);
+        declareLets(programNode, globals);
+        for (auto statement : programNode->statements) {
+            resolveNode(statement);
+        }
+        scopes.pop_back();
+    }
+    // declareLets: declare every 'let' reachable without entering a nested function.
+    void Resolver::declareLets(Node *node, Scope &scope) {
+        if (node == nullptr) return;
+        switch (node->type) {
+            case NT_PROGRAM:
+                for (auto statement : ((ProgramNode*)node)->statements) declareLets(statement, scope);
+                break;
+            case NT_BLOCK:
+                for (auto statement : ((BlockNode*)node)->statements) declareLets(statement, scope);
+                break;
+            case NT_LET:
+                scope.declare(((LetNode*)node)->ident->value.symbol);
+                declareLets(((LetNode*)node)->value, scope);
+                break;
+            case NT_RETURN:
+                declareLets(((ReturnNode*)node)->value, scope);
+                break;
+            case NT_BINARY:
+                declareLets(((BinOpNode*)node)->left, scope);
+                declareLets(((BinOpNode*)node)->right, scope);
+                break;
+            case NT_UNARY:
+                declareLets(((UnaryNode*)node)->left, scope);
+                break;
+            case NT_CALL:
+                declareLets(((CallExprNode*)node)->callee, scope);
+                for (auto argument : ((CallExprNode*)node)->arguments) declareLets(argument, scope);
+                break;
+            case NT_IF:
+                declareLets(((IfNode*)node)->condition, scope);
+                declareLets(((IfNode*)node)->consequence, scope);
+                declareLets(((IfNode*)node)->alternative, scope);
+                break;
+            case NT_WHILE:
+                declareLets(((WhileNode*)node)->condition, scope);
+                declareLets(((WhileNode*)node)->body, scope);
+                break;
+            case NT_FOR:
+                scope.declare(((ForNode*)node)->ident->value.symbol);
+                declareLets(((ForNode*)node)->iterable, scope);
+                declareLets(((ForNode*)node)->body, scope);
+                break;
+            case NT_ARRAY:
+                for (auto element : ((ArrayNode*)node)->elements) declareLets(element, scope);
+                break;
+            case NT_HASH:
+                for (auto key : ((HashNode*)node)->keys) declareLets(key, scope);
+                for (auto value : ((HashNode*)node)->values) declareLets(value, scope);
+                break;
+            default:
+                // literals, identifiers and nested functions (they have their own scope).
+                break;
+        }
+    }
+    // resolveNode
+    void Resolver::resolveNode(Node *node) {
+        if (node == nullptr) return;
+        switch (node->type) {
+            case NT_PROGRAM:
+                for (auto statement : ((ProgramNode*)node)->statements) resolveNode(statement);
+                break;
+            case NT_BLOCK:
+                for (auto statement : ((BlockNode*)node)->statements) resolveNode(statement);
+                break;
+            case NT_LET:
+            {
+                LetNode* letNode = (LetNode*)node;
+                resolveNode(letNode->value);
+                // a let always binds in the current scope.
+                letNode->ident->depth = 0;
+                letNode->ident->slot = scopes.back()->declare(letNode->ident->value.symbol);
+                break;
+            }
+            case NT_RETURN:
+                resolveNode(((ReturnNode*)node)->value);
+                break;
+            case NT_IDENT:
+                resolveIdent((IdentNode*)node);
+                break;
+            case NT_BINARY:
+                resolveNode(((BinOpNode*)node)->left);
+                resolveNode(((BinOpNode*)node)->right);
+                break;
+            case NT_UNARY:
+                resolveNode(((UnaryNode*)node)->left);
+                break;
+            case NT_CALL:
+                resolveNode(((CallExprNode*)node)->callee);
+                for (auto argument : ((CallExprNode*)node)->arguments) resolveNode(argument);
+                break;
+            case NT_IF:
+                resolveNode(((IfNode*)node)->condition);
+                resolveNode(((IfNode*)node)->consequence);
+                resolveNode(((IfNode*)node)->alternative);
+                break;
+            case NT_WHILE:
+                resolveNode(((WhileNode*)node)->condition);
+                resolveNode(((WhileNode*)node)->body);
+                break;
+            case NT_FOR:
+            {
+                ForNode* forNode = (ForNode*)node;
+                resolveNode(forNode->iterable);
+                // like a let, the loop variable binds in the current scope.
+                forNode->ident->depth = 0;
+                forNode->ident->slot = scopes.back()->declare(forNode->ident->value.symbol);
+                resolveNode(forNode->body);
+                break;
+            }
+            case NT_ARRAY:
+                for (auto element : ((ArrayNode*)node)->elements) resolveNode(element);
+                break;
+            case NT_HASH:
+                for (auto key : ((HashNode*)node)->keys) resolveNode(key);
+                for (auto value : ((HashNode*)node)->values) resolveNode(value);
+                break;
+            case NT_FUNCTION:
+                resolveFunction((FunctionNode*)node);
+                break;
+            default:
+                break;
+        }
+    }
+    // resolveFunction: parameters take the first slots, then the locals of the body.
+    void Resolver::resolveFunction(FunctionNode *functionNode) {
+        Scope& scope = functionNode->scope;
+        for (auto parameter : functionNode->parameters) {
+            parameter->depth = 0;
+            parameter->slot = scope.declare(parameter->value.symbol);
+        }
+        declareLets(functionNode->body, scope);
+
+        scopes.emplace_back(&scope);
+        for (auto statement : functionNode->body->statements) {
+            resolveNode(statement);
+        }
+        scopes.pop_back();
+        markTailCall(functionNode->body);
+        markReturns(functionNode->body);
+    }
+    // markTailCall: the value of 'node' is the value of the enclosing function, a call
+    // found there can reuse the frame of the function.
+    void Resolver::markTailCall(Node *node) {
+        if (node == nullptr) return;
+        switch (node->type) {
+            case NT_CALL:
+                ((CallExprNode*)node)->tail = true;
+                break;
+            case NT_RETURN:
+                markTailCall(((ReturnNode*)node)->value);
+                break;
+            case NT_BLOCK:
+            {
+                std::vector<Node*>& statements = ((BlockNode*)node)->statements;
+                if (!statements.empty()) markTailCall(statements.back());
+                break;
+            }
+            case NT_IF:
+                markTailCall(((IfNode*)node)->consequence);
+                markTailCall(((IfNode*)node)->alternative);
+                break;
+            default:
+                break;
+        }
+    }
+    // markReturns: the returned call of every 'return' statement is a tail call. A 'return'
+    // nested in an expression (e.g. in the arguments of another call) is left alone, the
+    // expression has to be unwound before the call could take over the frame.
+    void Resolver::markReturns(Node *node) {
+        if (node == nullptr) return;
+        switch (node->type) {
+            case NT_RETURN:
+                markTailCall(((ReturnNode*)node)->value);
+                break;
+            case NT_BLOCK:
+                for (auto statement : ((BlockNode*)node)->statements) markReturns(statement);
+                break;
+            case NT_IF:
+                markReturns(((IfNode*)node)->consequence);
+                markReturns(((IfNode*)node)->alternative);
+                break;
+            case NT_WHILE:
+                markReturns(((WhileNode*)node)->body);
+                break;
+            case NT_FOR:
+                markReturns(((ForNode*)node)->body);
+                break;
+            default:
+                break;
+        }
+    }
+    // resolveIdent: the innermost scope that declares the name wins.
+    void Resolver::resolveIdent(IdentNode *identNode) {
+        const Symbol* name = identNode->value.symbol;
+        int depth = 0;
+        for (auto it = scopes.rbegin(); it != scopes.rend(); ++it, ++depth) {
+            int slot = (*it)->find(name);
+            if (slot >= 0) {
+                identNode->depth = depth;
+                identNode->slot = slot;
+                return;
+            }
+        }
+        identNode->depth = -1;
+        identNode->slot = -1;
+    }
+}
@@ -0,0 +1,41 @@
+//
+// Created by irwin on 16/10/2026.
+//
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../header/source.h"
+
+namespace corny {
+    // ~Source
+    Source::~Source() {
+        if (mapped) {
+            munmap((void*)data, length);
+        }
+    }
+    // map: the lexer reads the file through the mapping, nothing is copied.
+    Source* Source::map(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return nullptr;
+        struct stat info;
+        if (fstat(fd, &info) < 0) {
+            close(fd);
+            return nullptr;
+        }
+        Source* source = new Source("");
+        if (info.st_size > 0) { // an empty file can not be mapped, it stays an empty buffer.
+            void* memory = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (memory == MAP_FAILED) {
+                close(fd);
+                delete source;
+                return nullptr;
+            }
+            source->data = (const char*)memory;
+            source->length = info.st_size;
+            source->mapped = true;
+        }
+        close(fd); // the mapping stays valid after the descriptor is closed.
+        return source;
+    }
+}
@@ -0,0 +1,50 @@
+//
+// Created by irwin on 16/10/2026.
+//
+#include "../header/symbol.h"
+#include "../header/table.h"
+
+namespace corny {
+    // SymbolTable: keywords are interned first, with their token type.
+    SymbolTable::SymbolTable() {
+        buckets.assign(256, nullptr);
+        for (size_t i = 0; i < keywordCount; i++) {
+            intern(keywords[i].name)->keyword = keywords[i].type;
+        }
+    }
+    // intern
+    Symbol* SymbolTable::intern(std::string_view text) {
+        uint32_t hash = hashString(text);
+        size_t mask = buckets.size() - 1;
+        size_t i = hash & mask;
+        for (; buckets[i] != nullptr; i = (i + 1) & mask) {
+            if (buckets[i]->hash == hash && buckets[i]->name == text) return buckets[i];
+        }
+        Symbol* symbol = arena.make<Symbol>();
+        symbol->name = std::string(text);
+        symbol->hash = hash;
+        buckets[i] = symbol;
+        // keep the load factor under 1/2.
+        if (++count * 2 > buckets.size()) grow();
+        return symbol;
+    }
+    // grow: double the buckets and put every symbol back.
+    void SymbolTable::grow() {
+        std::vector<Symbol*> old = std::move(buckets);
+        buckets.assign(old.size() * 2, nullptr);
+        size_t mask = buckets.size() - 1;
+        for (auto symbol : old) {
+            if (symbol == nullptr) continue;
+            size_t i = symbol->hash & mask;
+            while (buckets[i] != nullptr) {
+                i = (i + 1) & mask;
+            }
+            buckets[i] = symbol;
+        }
+    }
+    // intern
+    Symbol* intern(std::string_view text) {
+        static SymbolTable symbols;
+        return symbols.intern(text);
+    }
+}
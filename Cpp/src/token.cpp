@@ -3,9 +3,10 @@
 //
 
 #include "../header/token.h"
+#include "../header/symbol.h"
 
 namespace corny {
-    std::map<std::string, TokenType> keywords ({
+    const Keyword keywords[] = {
         {"fn",  TT_FUNCTION},
         {"let", TT_LET},
         {"true", TT_TRUE},
@@ -16,12 +17,14 @@ namespace corny {
         {"null", TT_NULL},
         {"and", TT_AND},
         {"or", TT_OR},
-    });
+        {"while", TT_WHILE},
+        {"for", TT_FOR},
+        {"in", TT_IN},
+    };
+    const size_t keywordCount = sizeof(keywords) / sizeof(keywords[0]);
+
     // isKeyword: check if 'ident' is a keyword or a ident token.
-    TokenType isKeyword(std::string ident) {
-        if (keywords.find(ident) == keywords.end()) {
-            return TT_IDENT;
-        }
-        return keywords[ident];
+    TokenType isKeyword(std::string_view ident) {
+        return intern(ident)->keyword;
     }
 }
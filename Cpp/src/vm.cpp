@@ -0,0 +1,354 @@
+//
+// Created by irwin on 16/10/2026.
+//
+#include "../header/vm.h"
+
+namespace corny {
+    // check whether passed value is an error signal.
+    bool VM::isError(Value value) {
+        return value.isError();
+    }
+    // newError: signal an error without allocating, fail turns it into an ErrorObj.
+    Value VM::newError(std::string message) {
+        errorMessage = std::move(message);
+        return Value::signal(Value::TAG_ERROR);
+    }
+    // run: execute a compiled program in the given (global) environment.
+    Value VM::run(FunctionProto *proto, Environment *env) {
+        stack.clear();
+        frames.clear();
+        gc.frames.clear();
+        push(NIL); // the script occupies the callee slot of its own frame.
+        frames.emplace_back(CallFrame{proto, 0, env, 0});
+        gc.frames.emplace_back(env);
+        return execute();
+    }
+    // runtimeError: abandon the execution, errors stop the whole program like in the Evaluator.
+    Value VM::runtimeError(std::string message) {
+        errorMessage = std::move(message);
+        return fail();
+    }
+    // fail: unwind every frame and hand the error back to the caller of run.
+    Value VM::fail() {
+        // allocate while the frames are still rooted.
+        Value errorObj = Value::object(gc.make<ErrorObj>(errorMessage));
+        stack.clear();
+        frames.clear();
+        gc.frames.clear();
+        return errorObj;
+    }
+    // execute: the dispatch loop.
+    Value VM::execute() {
+        CallFrame* frame = &frames.back();
+        Chunk* chunk = &frame->proto->chunk;
+        while (true) {
+            uint8_t instruction = chunk->code[frame->ip++];
+            switch (instruction) {
+                case OP_CONSTANT:
+                    push(chunk->constants[chunk->readShort(frame->ip)]);
+                    frame->ip += 2;
+                    break;
+                case OP_TRUE:
+                    push(TRUE);
+                    break;
+                case OP_FALSE:
+                    push(FALSE);
+                    break;
+                case OP_NULL:
+                    push(NIL);
+                    break;
+                case OP_POP:
+                    pop();
+                    break;
+                case OP_GET_NAME:
+                {
+                    const Symbol* name = chunk->names[chunk->readShort(frame->ip)];
+                    frame->ip += 2;
+                    Value value = frame->env->get(name);
+                    if (value.isEmpty()) return runtimeError("variable not defined: " + name->name);
+                    push(value);
+                    break;
+                }
+                case OP_GET_SLOT:
+                {
+                    int depth = chunk->code[frame->ip];
+                    int slot = chunk->readShort(frame->ip + 1);
+                    const Symbol* name = chunk->names[chunk->readShort(frame->ip + 3)];
+                    frame->ip += 5;
+                    Value value = frame->env->get(depth, slot, name);
+                    if (value.isEmpty()) return runtimeError("variable not defined: " + name->name);
+                    push(value);
+                    break;
+                }
+                case OP_SET_SLOT:
+                    gc.write(frame->env, chunk->readShort(frame->ip), peek(0));
+                    frame->ip += 2;
+                    break;
+                case OP_ADD:
+                case OP_SUB:
+                case OP_MUL:
+                case OP_DIV:
+                case OP_LESS:
+                case OP_LESS_EQ:
+                case OP_GREATER:
+                case OP_GREATER_EQ:
+                case OP_EQUAL:
+                case OP_NOT_EQ:
+                {
+                    Value resultObj = binaryOp((OpCode)instruction, peek(1), peek(0));
+                    if (isError(resultObj)) return fail();
+                    stack.resize(stack.size() - 2);
+                    push(resultObj);
+                    break;
+                }
+                case OP_NEGATE:
+                {
+                    Value rightObj = peek(0);
+                    if (!rightObj.isNumber()) return runtimeError("Invalid data type");
+                    stack.back() = Value::number(rightObj.asNumber() * -1);
+                    break;
+                }
+                case OP_NOT:
+                {
+                    Value rightObj = peek(0);
+                    if (!rightObj.isBoolean()) return runtimeError("Invalid data type");
+                    stack.back() = (rightObj.asBoolean() == true) ? FALSE : TRUE;
+                    break;
+                }
+                case OP_AND:
+                case OP_OR:
+                {
+                    uint16_t offset = chunk->readShort(frame->ip);
+                    frame->ip += 2;
+                    Value leftObj = peek(0);
+                    if (!leftObj.isBoolean()) return runtimeError("Invalid left hand type operand");
+                    // 'and' stops on false, 'or' stops on true.
+                    if (leftObj.asBoolean() == (instruction == OP_OR)) {
+                        frame->ip += offset;
+                    } else {
+                        pop();
+                    }
+                    break;
+                }
+                case OP_CHECK_BOOL:
+                    if (!peek(0).isBoolean()) return runtimeError("Invalid right hand type operand");
+                    break;
+                case OP_JUMP:
+                    frame->ip += chunk->readShort(frame->ip) + 2;
+                    break;
+                case OP_JUMP_IF_FALSE:
+                {
+                    uint16_t offset = chunk->readShort(frame->ip);
+                    frame->ip += 2;
+                    Value conditionObj = pop();
+                    if (!conditionObj.isBoolean()) return runtimeError("Invalid data type for if condition");
+                    if (conditionObj.asBoolean() == false) frame->ip += offset;
+                    break;
+                }
+                case OP_WHILE:
+                {
+                    uint16_t offset = chunk->readShort(frame->ip);
+                    frame->ip += 2;
+                    Value conditionObj = pop();
+                    if (!conditionObj.isBoolean()) return runtimeError("Invalid data type for while condition");
+                    if (conditionObj.asBoolean() == false) frame->ip += offset;
+                    break;
+                }
+                case OP_FOR:
+                {
+                    uint16_t slot = chunk->readShort(frame->ip);
+                    uint16_t offset = chunk->readShort(frame->ip + 2);
+                    frame->ip += 4;
+                    Value iterableObj = peek(1);
+                    if (!iterableObj.is(OBJ_ARRAY)) return runtimeError("Invalid data type for loop iterable");
+                    ArrayObj* arrayObj = (ArrayObj*)iterableObj.asObject();
+                    size_t index = peek(0).asNumber();
+                    if (index >= arrayObj->elements.size()) {
+                        stack.resize(stack.size() - 2);
+                        frame->ip += offset;
+                        break;
+                    }
+                    stack.back() = Value::number(index + 1);
+                    gc.write(frame->env, slot, arrayObj->elements[index]);
+                    break;
+                }
+                case OP_LOOP:
+                {
+                    uint16_t offset = chunk->readShort(frame->ip);
+                    frame->ip += 2;
+                    frame->ip -= offset;
+                    break;
+                }
+                case OP_ARRAY:
+                {
+                    uint16_t count = chunk->readShort(frame->ip);
+                    frame->ip += 2;
+                    // allocate first, the elements are copied once they can not move anymore.
+                    ArrayObj* arrayObj = gc.make<ArrayObj>();
+                    arrayObj->elements.assign(stack.end() - count, stack.end());
+                    stack.resize(stack.size() - count);
+                    push(Value::object(arrayObj));
+                    break;
+                }
+                case OP_HASH_KEY:
+                    if (!peek(0).is(OBJ_STRING)) return runtimeError("Invalid data type for key");
+                    break;
+                case OP_HASH:
+                {
+                    uint16_t count = chunk->readShort(frame->ip);
+                    frame->ip += 2;
+                    HashObj* hashObj = gc.make<HashObj>();
+                    hashObj->elements.reserve(count);
+                    for (size_t i = stack.size() - count * 2; i < stack.size(); i += 2) {
+                        StringObj* key = (StringObj*)stack[i].asObject();
+                        hashObj->elements.set(key->value, key->hashCode(), key->symbol, stack[i + 1]);
+                    }
+                    stack.resize(stack.size() - count * 2);
+                    push(Value::object(hashObj));
+                    break;
+                }
+                case OP_CLOSURE:
+                {
+                    FunctionObj* functionObj = gc.make<FunctionObj>();
+                    functionObj->proto = chunk->functions[chunk->readShort(frame->ip)];
+                    functionObj->proto->retain(); // keep the script alive while the function is
+                    functionObj->env = frame->env;
+                    frame->env->captured = true; // the environment outlives its call now
+                    frame->ip += 2;
+                    push(Value::object(functionObj));
+                    break;
+                }
+                case OP_CALL:
+                case OP_TAIL_CALL:
+                {
+                    int argc = chunk->code[frame->ip++];
+                    InlineCache& cache = chunk->caches[chunk->readShort(frame->ip)];
+                    frame->ip += 2;
+                    Value calleeObj = peek(argc);
+                    if (calleeObj.is(OBJ_FUNCTION) && instruction == OP_TAIL_CALL) {
+                        // move the callee and the arguments over the frame and drop it, the
+                        // callee returns straight to our caller.
+                        std::copy(stack.end() - argc - 1, stack.end(), stack.begin() + frame->base);
+                        stack.resize(frame->base + argc + 1);
+                        gc.releaseFrame(frame->env);
+                        frames.pop_back();
+                        gc.frames.pop_back();
+                    }
+                    if (calleeObj.is(OBJ_FUNCTION)) {
+                        Value errorObj = callValue(calleeObj, argc);
+                        if (isError(errorObj)) return fail();
+                        frame = &frames.back();
+                        chunk = &frame->proto->chunk;
+                        break;
+                    }
+                    Value resultObj = accessValue(calleeObj, argc, cache);
+                    if (isError(resultObj)) return fail();
+                    stack.resize(stack.size() - argc - 1);
+                    push(resultObj);
+                    break;
+                }
+                case OP_RETURN:
+                {
+                    Value resultObj = pop();
+                    stack.resize(frame->base);
+                    if (frames.size() > 1) gc.releaseFrame(frame->env); // the script frame runs in the caller's environment
+                    frames.pop_back();
+                    gc.frames.pop_back();
+                    if (frames.empty()) return resultObj;
+                    push(resultObj);
+                    frame = &frames.back();
+                    chunk = &frame->proto->chunk;
+                    break;
+                }
+                default:
+                    return runtimeError("Unknown instruction.");
+            }
+        }
+    }
+    // callValue: push a new frame for a FunctionObj. Returns an error signal on arity mismatch.
+    Value VM::callValue(Value calleeObj, int argc) {
+        FunctionObj* functionObj = (FunctionObj*)calleeObj.asObject();
+        FunctionProto* proto = functionObj->proto;
+        int numParams = proto->parameters.size();
+        if (argc != numParams) {
+            return newError("Unexpected arguments, got: " + std::to_string(argc) + " want: " + std::to_string(numParams));
+        }
+        if (frames.size() > maxDepth) { // the script frame is not a call
+            return newError("Stack overflow: more than " + std::to_string(maxDepth) + " nested calls");
+        }
+        Environment* newEnv = gc.newEnvironment(&proto->scope, functionObj->env);
+        size_t first = stack.size() - argc;
+        for (int i = 0; i < numParams; i++) {
+            gc.write(newEnv, proto->parameters[i], stack[first + i]);
+        }
+        frames.emplace_back(CallFrame{proto, 0, newEnv, first - 1});
+        gc.frames.emplace_back(newEnv);
+        return NIL;
+    }
+    // accessValue: array, hash and string subscripts. The index is the first argument.
+    Value VM::accessValue(Value calleeObj, int argc, InlineCache& cache) {
+        Value indexObj = (argc > 0) ? peek(argc - 1) : NIL;
+        switch (calleeObj.type()) {
+            case OBJ_ARRAY:
+            {
+                if (!indexObj.isNumber()) return newError("Invalid subscript reference");
+                ArrayObj* arrayObj = (ArrayObj*)calleeObj.asObject();
+                int index = indexObj.asNumber();
+                if (index < 0 || (size_t)index >= arrayObj->elements.size()) return newError("Index out of bounds");
+                return arrayObj->elements[index];
+            }
+            case OBJ_HASH:
+            {
+                if (!indexObj.is(OBJ_STRING)) return newError("Invalid subscript reference");
+                HashObj* hashObj = (HashObj*)calleeObj.asObject();
+                StringObj* key = (StringObj*)indexObj.asObject();
+                Value* value = cache.find(hashObj->elements, key->value, key->hashCode(), key->symbol);
+                if (value != nullptr) return *value;
+                return NIL;
+            }
+            case OBJ_STRING:
+            {
+                if (!indexObj.isNumber()) return newError("Invalid subscript reference");
+                StringObj* stringObj = (StringObj*)calleeObj.asObject();
+                int index = indexObj.asNumber();
+                if (index < 0 || (size_t)index > stringObj->value.length()) return newError("Index out of bounds");
+                return Value::object(gc.make<StringObj>(std::string(1, stringObj->value[index])));
+            }
+            default:
+                return newError("Invalid callable object.");
+        }
+    }
+    // binaryOp: same rules as Evaluator::evalBinaryExpression.
+    Value VM::binaryOp(OpCode opCode, Value leftObj, Value rightObj) {
+        double left, right;
+        if (leftObj.isNumber() && rightObj.isNumber()) {
+            left = leftObj.asNumber();
+            right = rightObj.asNumber();
+        } else if (leftObj.is(OBJ_STRING) && rightObj.is(OBJ_STRING)) {
+            if (opCode != OP_ADD) return newError("Invalid operator");
+            return Value::object(gc.make<StringObj>(((StringObj*)leftObj.asObject())->value + ((StringObj*)rightObj.asObject())->value));
+        } else if (leftObj.isBoolean() && rightObj.isBoolean()) {
+            // booleans are compared (and operated) as 1 and 0.
+            left = leftObj.asBoolean() ? 1 : 0;
+            right = rightObj.asBoolean() ? 1 : 0;
+        } else {
+            return newError("Invalid operand types for binary operation");
+        }
+        switch (opCode) {
+            case OP_ADD: return Value::number(left + right);
+            case OP_SUB: return Value::number(left - right);
+            case OP_MUL: return Value::number(left * right);
+            case OP_DIV:
+                if (right == 0) return newError("Division by zero.");
+                return Value::number(left / right);
+            case OP_LESS: return (left < right) ? TRUE : FALSE;
+            case OP_LESS_EQ: return (left <= right) ? TRUE : FALSE;
+            case OP_GREATER: return (left > right) ? TRUE : FALSE;
+            case OP_GREATER_EQ: return (left >= right) ? TRUE : FALSE;
+            case OP_EQUAL: return (left == right) ? TRUE : FALSE;
+            case OP_NOT_EQ: return (left != right) ? TRUE : FALSE;
+            default:
+                return newError("Invalid operator.");
+        }
+    }
+}
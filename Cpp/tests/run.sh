@@ -0,0 +1,52 @@
+#!/bin/sh
+#
+# Created by irwin on 16/10/2026.
+#
+# run.sh: feed every tests/*.corny to the REPL of the given corny binary, once per engine
+# (the evaluator, its stackless mode and the VM), and compare what it prints after the banner with
+# tests/<name>.out. Every line of a script is one REPL line, an empty line would end
+# the session. Each line of tests/<name>.flags is a set of options to run the script
+# with, once per line, and every run has to print the same output. The whole programs in tests/scripts/*.corny are run with 'corny run <file>'
+# instead, their .out holds the printed result (the timings on stderr are dropped).
+#
+# usage: tests/run.sh <path to corny>
+
+CORNY=${1:?usage: tests/run.sh <path to corny>}
+DIR=$(dirname "$0")
+FAILED=0
+
+# check <name> <engine> <output> <expected file>
+check() {
+    if [ "$3" = "$(cat "$4")" ]; then
+        echo "ok   $1 $2"
+    else
+        echo "FAIL $1 $2"
+        echo "$3" | diff "$4" - | head -20
+        FAILED=1
+    fi
+}
+
+for script in "$DIR"/*.corny; do
+    name=$(basename "$script" .corny)
+    flagsets=""
+    [ -f "$DIR/$name.flags" ] && flagsets=$(cat "$DIR/$name.flags")
+    while IFS= read -r flags; do
+        for engine in "" "--stackless" "--engine=vm"; do
+            # shellcheck disable=SC2086
+            output=$("$CORNY" $engine $flags < "$script" 2>&1 | awk 'found { print } /^Type: /{ found = 1 }')
+            check "$name" "$engine $flags" "$output" "$DIR/$name.out"
+        done
+    done <<EOF
+$flagsets
+EOF
+done
+
+for script in "$DIR"/scripts/*.corny; do
+    name=$(basename "$script" .corny)
+    for engine in "" "--stackless" "--engine=vm"; do
+        # shellcheck disable=SC2086
+        output=$("$CORNY" $engine run "$script" 2>/dev/null)
+        check "scripts/$name" "$engine" "$output" "$DIR/scripts/$name.out"
+    done
+done
+exit $FAILED